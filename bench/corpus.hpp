@@ -0,0 +1,370 @@
+#ifndef PMM_LOOKUPPER_BENCH_CORPUS_HPP_
+#define PMM_LOOKUPPER_BENCH_CORPUS_HPP_
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+#include "../src/filesystem.hpp"
+#include "../src/pmm.hpp"
+
+// Deterministic synthetic .pmm and .emm files. Paths are Shift-JIS and include
+// a trail byte of 0x5c ("\x95\x5c" is 表).
+namespace pmm_lookupper { namespace bench {
+
+	// PMM record sizes, added up field by field from the format rather than taken
+	// from the parser, so that a generated file checks the parser's own constants.
+	namespace pmm_record {
+
+		// "Polygon Movie maker 000N" padded to 30 bytes.
+		std::size_t const header = 24 + 6;
+		// Names in v1 are fixed PMD names; v2 ones are length-prefixed.
+		std::size_t const name_v1 = 20;
+		std::size_t const accessory_name = 100;
+		std::size_t const path = 256;
+
+		// Every frame after the first of a track is preceded by its data index.
+		std::size_t const keyframe_index = 4;
+		// Frame number, previous and next frame.
+		std::size_t const frame_links = 4 + 4 + 4;
+
+		// Interpolation, translation, rotation, selected, physics off.
+		std::size_t const bone_frame = frame_links + 4 * 4 + 3 * 4 + 4 * 4 + 1 + 1;
+		// Weight, selected.
+		std::size_t const morph_frame = frame_links + 4 + 1;
+		// Visible, selected; each IK and parent adds to it.
+		std::size_t const op_frame_base = frame_links + 1 + 1;
+		// Distance, position, rotation, followed model and bone, interpolation,
+		// perspective, view angle, selected.
+		std::size_t const camera_frame = frame_links + 4 + 3 * 4 + 3 * 4 + 4 + 4 + 6 * 4 + 1 + 4 + 1;
+		// Colour, direction, selected.
+		std::size_t const light_frame = frame_links + 3 * 4 + 3 * 4 + 1;
+		// Opacity and visibility, parent model and bone, translation, rotation,
+		// scale, shadow, selected.
+		std::size_t const accessory_frame = frame_links + 1 + 4 + 4 + 3 * 4 + 3 * 4 + 4 + 1 + 1;
+
+		// Translation, rotation, edited, physics off, selected.
+		std::size_t const bone_current = 3 * 4 + 4 * 4 + 1 + 1 + 1;
+		// Position, target, rotation, perspective.
+		std::size_t const camera_current = 3 * 4 + 3 * 4 + 3 * 4 + 1;
+		// Colour, direction, selected.
+		std::size_t const light_current = 3 * 4 + 3 * 4 + 1;
+		// Opacity and visibility, parent model and bone, translation, rotation,
+		// scale, shadow.
+		std::size_t const accessory_current = 1 + 4 + 4 + 3 * 4 + 3 * 4 + 4 + 1;
+
+	} // namespace pmm_record
+
+	struct pmm_spec
+	{
+		int version;
+		std::size_t models;
+		std::size_t bones;
+		std::size_t morphs;
+		std::size_t keyframes;
+		std::size_t accessories;
+	};
+
+	class corpus_writer
+	{
+		std::mt19937 rng_;
+		std::vector< char > buf_;
+
+	public:
+		explicit corpus_writer(std::uint32_t seed) :
+			rng_( seed )
+		{ }
+
+		std::vector< char > take()
+		{
+			std::vector< char > result;
+			result.swap( buf_ );
+
+			return result;
+		}
+
+		void bytes(std::string const& s)
+		{
+			buf_.insert( buf_.end(), s.begin(), s.end() );
+		}
+
+		void u8(std::uint8_t v)
+		{
+			buf_.push_back( static_cast< char >( v ) );
+		}
+
+		void i32(std::int32_t v)
+		{
+			auto const u = static_cast< std::uint32_t >( v );
+			for( int i = 0; i < 4; ++i ) {
+				buf_.push_back( static_cast< char >( ( u >> ( i * 8 ) ) & 0xff ) );
+			}
+		}
+
+		void zeros(std::size_t n)
+		{
+			buf_.insert( buf_.end(), n, '\0' );
+		}
+
+		// Keyframe data: arbitrary bytes that never form a path.
+		void noise(std::size_t n)
+		{
+			std::uniform_int_distribution< int > byte( 0x80, 0xff );
+			for( std::size_t i = 0; i < n; ++i ) {
+				buf_.push_back( static_cast< char >( byte( rng_ ) ) );
+			}
+		}
+
+		void field(std::string const& s, std::size_t size)
+		{
+			bytes( s.substr( 0, size - 1 ) );
+			zeros( size - std::min( s.size(), size - 1 ) );
+		}
+
+		void name(int version, std::string const& s)
+		{
+			if( version == 1 ) {
+				field( s, pmm_record::name_v1 );
+			}
+			else {
+				u8( static_cast< std::uint8_t >( s.size() ) );
+				bytes( s );
+			}
+		}
+	};
+
+	inline std::string model_path(std::size_t i)
+	{
+		return "C:\\MMD\\UserFile\\Model\\\x8f\x89\x89\xb9\x83\x7e\x83\x4e\\\x95\x5c\x8e\xa6_" + std::to_string( i ) + ".pmx";
+	}
+
+	inline std::string accessory_path(std::size_t i)
+	{
+		return "D:\\MMD\\Accessory\\\x83\x58\x83\x65\x81\x5b\x83\x57\\stage_" + std::to_string( i ) + ".x";
+	}
+
+	inline std::string effect_path(std::size_t i)
+	{
+		return "C:\\MMD\\Effect\\\x95\x5c\x8e\xa6\\effect_" + std::to_string( i ) + ".fx";
+	}
+
+	// Paths found in a file made by make_pmm: one per model and accessory, and
+	// the wave file of the settings block.
+	inline std::size_t pmm_path_count(pmm_spec const& spec)
+	{
+		return spec.models + spec.accessories + 1;
+	}
+
+	// Scenes share their paths with the scenes whose seeds agree modulo 16.
+	inline std::vector< char > make_pmm(pmm_spec const& spec, std::uint32_t seed = 1)
+	{
+		namespace l = pmm_record;
+
+		corpus_writer w( seed );
+		auto const v = spec.version;
+		std::size_t const variant = seed % 16;
+		auto const frames = static_cast< std::int32_t >( spec.keyframes );
+
+		w.field( std::string( "Polygon Movie maker 000" ) + static_cast< char >( '0' + v ), l::header );
+		w.zeros( 4 + 4 + 4 + 4 + 7 );
+		w.u8( 0 );
+		w.u8( static_cast< std::uint8_t >( spec.models ) );
+
+		std::size_t const iks = 2;
+		std::size_t const ops = 1;
+		for( std::size_t m = 0; m < spec.models; ++m ) {
+			w.u8( static_cast< std::uint8_t >( m ) );
+			w.name( v, "model" + std::to_string( m ) );
+			if( v != 1 ) {
+				w.name( v, "model" + std::to_string( m ) );
+			}
+			w.field( model_path( variant * spec.models + m ), l::path );
+			w.u8( 1 );
+
+			w.i32( static_cast< std::int32_t >( spec.bones ) );
+			for( std::size_t i = 0; i < spec.bones; ++i ) {
+				w.name( v, "bone" + std::to_string( i ) );
+			}
+			w.i32( static_cast< std::int32_t >( spec.morphs ) );
+			for( std::size_t i = 0; i < spec.morphs; ++i ) {
+				w.name( v, "morph" + std::to_string( i ) );
+			}
+			w.i32( iks );
+			w.zeros( iks * 4 );
+			w.i32( ops );
+			w.zeros( ops * 4 );
+
+			w.zeros( 1 + 1 + 4 + 16 );
+			w.u8( 0 );
+			w.zeros( 4 + 4 );
+
+			w.noise( spec.bones * l::bone_frame );
+			w.i32( frames );
+			w.noise( spec.keyframes * ( l::keyframe_index + l::bone_frame ) );
+			w.noise( spec.morphs * l::morph_frame );
+			w.i32( frames );
+			w.noise( spec.keyframes * ( l::keyframe_index + l::morph_frame ) );
+
+			auto const op_frame = l::op_frame_base + iks + ops * 8;
+			w.noise( op_frame );
+			w.i32( 0 );
+
+			w.noise( spec.bones * l::bone_current );
+			w.noise( spec.morphs * 4 );
+			w.zeros( iks );
+			w.zeros( ops * 8 );
+			w.zeros( 1 + 4 + 1 + 1 );
+		}
+
+		w.noise( l::camera_frame );
+		w.i32( frames );
+		w.noise( spec.keyframes * ( l::keyframe_index + l::camera_frame ) );
+		w.noise( l::camera_current );
+		w.noise( l::light_frame );
+		w.i32( 0 );
+		w.noise( l::light_current );
+
+		w.u8( 0 );
+		w.i32( 0 );
+		w.u8( static_cast< std::uint8_t >( spec.accessories ) );
+		for( std::size_t a = 0; a < spec.accessories; ++a ) {
+			w.field( "accessory" + std::to_string( a ), l::accessory_name );
+		}
+		for( std::size_t a = 0; a < spec.accessories; ++a ) {
+			w.u8( static_cast< std::uint8_t >( a ) );
+			w.field( "accessory" + std::to_string( a ), l::accessory_name );
+			w.field( accessory_path( variant * spec.accessories + a ), l::path );
+			w.u8( 1 );
+			w.noise( l::accessory_frame );
+			w.i32( 0 );
+			w.noise( l::accessory_current );
+			w.u8( 0 );
+		}
+
+		// Settings block: the wave file and unused path fields.
+		w.zeros( 16 );
+		w.field( "C:\\MMD\\Music\\\x8b\xc8.wav", l::path );
+		w.zeros( l::path * 3 );
+
+		return w.take();
+	}
+
+	// A scene of roughly size bytes, grown through the keyframe count.
+	inline pmm_spec pmm_spec_of_size(int version, std::size_t size)
+	{
+		pmm_spec spec = { version, 8, 64, 16, 0, 4 };
+
+		auto base = make_pmm( spec ).size();
+		if( base > size ) {
+			spec = { version, 2, 8, 4, 0, 1 };
+			base = make_pmm( spec ).size();
+		}
+		auto const per_frame = spec.models * ( 8 + pmm_record::bone_frame + pmm_record::morph_frame )
+			+ pmm_record::keyframe_index + pmm_record::camera_frame;
+		spec.keyframes = size > base ? ( size - base ) / per_frame : 0;
+
+		return spec;
+	}
+
+	// An .emm assigning an effect to each of models models and accessories, in
+	// [Effect] and one offscreen section.
+	inline std::vector< char > make_emm(std::size_t models, std::size_t accessories)
+	{
+		corpus_writer w( 2 );
+		w.bytes( "[Info]\r\nVersion = 3\r\n\r\n[Object]\r\n" );
+		for( std::size_t i = 0; i < models; ++i ) {
+			w.bytes( "Pmd" + std::to_string( i + 1 ) + " = " + model_path( i ) + "\r\n" );
+		}
+		for( std::size_t i = 0; i < accessories; ++i ) {
+			w.bytes( "Acs" + std::to_string( i + 1 ) + " = " + accessory_path( i ) + "\r\n" );
+		}
+
+		for( auto const section : { "[Effect]", "[Effect@ShadowBuffer]" } ) {
+			w.bytes( std::string( "\r\n" ) + section + "\r\nOwner = none\r\n" );
+			for( std::size_t i = 0; i < models; ++i ) {
+				w.bytes( "Pmd" + std::to_string( i + 1 ) + " = " + effect_path( i ) + "\r\n" );
+				w.bytes( "Pmd" + std::to_string( i + 1 ) + ".show = true\r\n" );
+			}
+			for( std::size_t i = 0; i < accessories; ++i ) {
+				w.bytes( "Acs" + std::to_string( i + 1 ) + " = " + effect_path( models + i ) + "\r\n" );
+			}
+		}
+
+		return w.take();
+	}
+
+	// The model count for an .emm of roughly size bytes.
+	inline std::size_t emm_models_of_size(std::size_t size)
+	{
+		auto const base = make_emm( 1, 0 ).size();
+		auto const per_model = make_emm( 2, 0 ).size() - base;
+
+		return size > base ? ( size - base ) / per_model + 1 : 1;
+	}
+
+	// n Shift-JIS paths as a scene list holds them, about half of them repeated.
+	inline path_list make_paths(std::size_t n, std::uint32_t seed = 3)
+	{
+		static char const* const exts[] = { ".pmx", ".pmd", ".x", ".wav", ".bmp", ".fx", ".fxsub", ".png" };
+
+		std::mt19937 rng( seed );
+		std::uniform_int_distribution< std::size_t > id( 0, n / 2 + 1 );
+		std::uniform_int_distribution< std::size_t > ext( 0, sizeof( exts ) / sizeof( exts[0] ) - 1 );
+
+		path_list result;
+		std::string path;
+		for( std::size_t i = 0; i < n; ++i ) {
+			auto const k = id( rng );
+			path = "C:\\MMD\\UserFile\\\x95\x5c\x8e\xa6" + std::to_string( k % 97 ) + "\\file_" + std::to_string( k )
+				+ exts[( k + ext( rng ) / 4 ) % ( sizeof( exts ) / sizeof( exts[0] ) )];
+			result.push_back( path );
+		}
+
+		return result;
+	}
+
+	// Paths found in a file made by make_emm.
+	inline std::size_t emm_path_count(std::size_t models, std::size_t accessories)
+	{
+		return ( models + accessories ) * 2;
+	}
+
+	inline bool write_file(std::string const& path, std::vector< char > const& data)
+	{
+		std::ofstream ofs( path, std::ios::binary );
+		ofs.write( data.data(), static_cast< std::streamsize >( data.size() ) );
+
+		return !ofs.fail();
+	}
+
+	// n scenes of 20 KB to 2 MB in dir, v1 and v2 alternating, every other one
+	// with an .emm and every fourth a copy of an earlier one.
+	inline bool write_corpus(std::string const& dir, std::size_t n)
+	{
+		std::mt19937 rng( 4 );
+		std::uniform_int_distribution< std::size_t > size( 20 * 1024, 2 * 1024 * 1024 );
+
+		std::vector< char > prev;
+		for( std::size_t i = 0; i < n; ++i ) {
+			auto const name = join_path( dir, "scene_" + std::to_string( i ) );
+			auto const sz = size( rng );
+
+			auto data = i % 4 == 3 && !prev.empty() ? prev : make_pmm( pmm_spec_of_size( static_cast< int >( i % 2 ) + 1, sz ), static_cast< std::uint32_t >( i ) );
+			if( !write_file( name + ".pmm", data ) ) {
+				return false;
+			}
+			if( i % 2 == 0 && !write_file( name + ".emm", make_emm( 8, 4 ) ) ) {
+				return false;
+			}
+			prev.swap( data );
+		}
+
+		return true;
+	}
+
+} } // namespace pmm_lookupper::bench
+
+#endif // PMM_LOOKUPPER_BENCH_CORPUS_HPP_
@@ -0,0 +1,75 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+#include <vector>
+#include "../src/export.hpp"
+#include "corpus.hpp"
+
+namespace {
+
+	template <class F>
+	void run(char const* name, std::size_t rows, std::string const& file, F f)
+	{
+		auto const t0 = std::chrono::steady_clock::now();
+		bool const ok = f();
+		auto const t1 = std::chrono::steady_clock::now();
+
+		if( !ok ) {
+			std::fprintf( stderr, "cannot write %s\n", file.c_str() );
+			std::exit( 1 );
+		}
+
+		double const sec = std::chrono::duration< double >( t1 - t0 ).count();
+		auto const bytes = pmm_lookupper::get_file_status( file ).size;
+		std::printf(
+			"%-10s %10.3f ms %12.0f rows/s %10.1f MB/s %10.1f MB\n",
+			name, sec * 1000.0, rows / sec, bytes / ( 1024.0 * 1024.0 ) / sec, bytes / ( 1024.0 * 1024.0 )
+		);
+	}
+
+} // namespace
+
+// bench_export dir [rows]: writes a result of rows paths (default 500000) to dir
+// line by line with std::endl, as the window used to, and in every export format.
+int main(int argc, char** argv)
+{
+	if( argc < 2 ) {
+		std::fprintf( stderr, "usage: %s dir [rows]\n", argv[0] );
+		return 2;
+	}
+
+	std::string const dir( argv[1] );
+	std::size_t const rows = argc > 2 ? std::strtoul( argv[2], nullptr, 10 ) : 500000;
+
+	// Scenes of 50 paths each.
+	pmm_lookupper::string_pool strings;
+	pmm_lookupper::path_sources sources;
+	sources.ids = pmm_lookupper::intern_paths( pmm_lookupper::bench::make_paths( rows ), strings );
+	for( std::size_t i = 0; i < rows; ++i ) {
+		if( i % 50 == 0 ) {
+			sources.files.push_back( "D:\\MMD\\scene_" + std::to_string( i / 50 ) + ".pmm" );
+		}
+		sources.file_of.push_back( static_cast< std::uint32_t >( sources.files.size() - 1 ) );
+	}
+	auto const& ids = sources.ids;
+
+	auto const endl_file = pmm_lookupper::join_path( dir, "endl.txt" );
+	run( "endl", rows, endl_file, [&] {
+		std::ofstream ofs( endl_file );
+		for( auto const id : ids ) {
+			ofs << strings[id] << std::endl;
+		}
+		return !ofs.fail();
+	} );
+
+	for( auto const name : { "export.txt", "export.tsv", "export.ndjson", "export.txt.gz", "export.tsv.gz", "export.ndjson.gz" } ) {
+		auto const file = pmm_lookupper::join_path( dir, name );
+		run( name + 7, rows, file, [&] {
+			return pmm_lookupper::export_rows( file, strings, ids, &sources, pmm_lookupper::export_options_of( file ) );
+		} );
+	}
+
+	return 0;
+}
@@ -0,0 +1,165 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <vector>
+#include "../src/emm.hpp"
+#include "../src/filter_engine.hpp"
+#include "../src/pmm.hpp"
+#include "../src/query.hpp"
+#include "corpus.hpp"
+
+namespace {
+
+	struct measure
+	{
+		std::size_t bytes;
+		std::size_t paths;
+	};
+
+	// Repeats f for at least a fifth of a second and prints the rate of one run.
+	template <class F>
+	void run(char const* name, std::size_t size, F f)
+	{
+		using clock = std::chrono::steady_clock;
+
+		measure m = { 0, 0 };
+		std::size_t iterations = 0;
+		auto const t0 = clock::now();
+		auto t1 = t0;
+		do {
+			m = f();
+			++iterations;
+			t1 = clock::now();
+		} while( t1 - t0 < std::chrono::milliseconds( 200 ) );
+
+		double const sec = std::chrono::duration< double >( t1 - t0 ).count() / iterations;
+		std::printf(
+			"%-8s %8zuK %10.1f MB/s %14.0f paths/s %10zu paths\n",
+			name, size / 1024, m.bytes / ( 1024.0 * 1024.0 ) / sec, m.paths / sec, m.paths
+		);
+	}
+
+	inline boost::string_ref range(std::vector< char > const& buf) noexcept
+	{
+		return boost::string_ref( buf.data(), buf.size() );
+	}
+
+	void check(bool ok, char const* what)
+	{
+		if( !ok ) {
+			std::fprintf( stderr, "generated %s does not parse\n", what );
+			std::exit( 1 );
+		}
+	}
+
+	void run_files(std::size_t size)
+	{
+		namespace bench = pmm_lookupper::bench;
+
+		for( int version = 1; version <= 2; ++version ) {
+			auto const spec = bench::pmm_spec_of_size( version, size );
+			auto const pmm = bench::make_pmm( spec );
+			auto const parsed = pmm_lookupper::parse_pmm_path_spans( range( pmm ) );
+			check( parsed && parsed->size() == bench::pmm_path_count( spec ), "pmm" );
+
+			run( version == 1 ? "pmm v1" : "pmm v2", size, [&] {
+				auto const paths = pmm_lookupper::parse_pmm_buffer( range( pmm ) );
+				return measure{ pmm.size(), paths ? paths->size() : 0 };
+			} );
+
+			// The whole-file scan that unknown layouts fall back to.
+			if( version == 2 ) {
+				run( "scan", size, [&] {
+					return measure{ pmm.size(), pmm_lookupper::find_file_paths( range( pmm ), '\0' ).size() };
+				} );
+			}
+		}
+
+		auto const models = bench::emm_models_of_size( size );
+		auto const emm = bench::make_emm( models, 0 );
+		auto const parsed = pmm_lookupper::parse_emm_buffer( range( emm ) );
+		check( parsed && parsed->size() == bench::emm_path_count( models, 0 ), "emm" );
+
+		run( "emm", size, [&] {
+			auto const paths = pmm_lookupper::parse_emm_buffer( range( emm ) );
+			return measure{ emm.size(), paths ? paths->size() : 0 };
+		} );
+	}
+
+	// Kernels over the paths of a load: conversion to UTF-8, the extension filter,
+	// building the index and a sorted query.
+	void run_paths(std::size_t size)
+	{
+		auto const n = size / 48 + 1;
+		auto const paths = pmm_lookupper::bench::make_paths( n );
+
+		std::size_t bytes = 0;
+		for( std::size_t i = 0; i < paths.size(); ++i ) {
+			bytes += paths[i].size();
+		}
+
+		run( "cp932", size, [&] {
+			std::string buf;
+			std::size_t total = 0;
+			for( std::size_t i = 0; i < paths.size(); ++i ) {
+				buf.clear();
+				pmm_lookupper::cp932_to_utf8( paths[i], buf );
+				total += buf.size();
+			}
+			return measure{ bytes, total ? paths.size() : 0 };
+		} );
+
+		auto strings = std::make_shared< pmm_lookupper::string_pool >();
+		auto const ids = pmm_lookupper::intern_paths( paths, *strings );
+
+		auto const exts = pmm_lookupper::parse_extensions( "pmx pmd x wav bmp fx fxsub" );
+		run( "filter", size, [&] {
+			std::size_t matched = 0;
+			for( auto const id : ids ) {
+				matched += pmm_lookupper::has_extension( ( *strings )[id], exts ) ? 1 : 0;
+			}
+			return measure{ bytes, matched ? ids.size() : 0 };
+		} );
+
+		run( "index", size, [&] {
+			pmm_lookupper::filter_engine engine( strings, ids );
+			return measure{ bytes, ids.size() };
+		} );
+
+		pmm_lookupper::query_options opts;
+		opts.extensions = exts;
+		opts.folder_only = false;
+		opts.duplication = false;
+		opts.order = pmm_lookupper::sort_order::path;
+		pmm_lookupper::filter_engine engine( strings, ids );
+		run( "query", size, [&] {
+			// A change of order makes every query a full one.
+			opts.order = opts.order == pmm_lookupper::sort_order::path ? pmm_lookupper::sort_order::extension : pmm_lookupper::sort_order::path;
+			return measure{ bytes, engine.query( opts ).size() };
+		} );
+	}
+
+} // namespace
+
+// bench_kernels [max_size_mb]: every kernel at 10 KB, 100 KB, 1 MB, 10 MB,
+// 100 MB and 1 GB, up to max_size_mb (default 100). The path kernels hold about
+// four times their size in memory.
+int main(int argc, char** argv)
+{
+	std::size_t const max_size = ( argc > 1 ? std::strtoul( argv[1], nullptr, 10 ) : 100 ) * 1024 * 1024;
+	std::size_t const sizes[] = {
+		10 * 1024, 100 * 1024, 1024 * 1024, 10 * 1024 * 1024, 100 * 1024 * 1024, 1024 * 1024 * 1024
+	};
+
+	for( auto const size : sizes ) {
+		if( size > max_size ) {
+			break;
+		}
+		run_files( size );
+		run_paths( size );
+	}
+
+	return 0;
+}
@@ -0,0 +1,245 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+#include "../src/engine.hpp"
+#include "../src/filter_engine.hpp"
+#include "../src/options.hpp"
+#include "../src/query.hpp"
+#include "corpus.hpp"
+
+#ifdef _WIN32
+#	include <psapi.h>
+#else
+#	include <sys/resource.h>
+#endif
+
+namespace {
+
+	using clock_type = std::chrono::steady_clock;
+
+	inline double ms_since(clock_type::time_point t0)
+	{
+		return std::chrono::duration< double, std::milli >( clock_type::now() - t0 ).count();
+	}
+
+	std::size_t peak_rss_kb()
+	{
+#ifdef _WIN32
+		PROCESS_MEMORY_COUNTERS pmc;
+		if( !GetProcessMemoryInfo( GetCurrentProcess(), &pmc, sizeof( pmc ) ) ) {
+			return 0;
+		}
+		return pmc.PeakWorkingSetSize / 1024;
+#else
+		struct rusage ru;
+		if( getrusage( RUSAGE_SELF, &ru ) != 0 ) {
+			return 0;
+		}
+		return static_cast< std::size_t >( ru.ru_maxrss );
+#endif
+	}
+
+	// Nearest-rank percentile of sorted values.
+	double percentile(std::vector< double > const& sorted, double p)
+	{
+		if( sorted.empty() ) {
+			return 0.0;
+		}
+
+		auto const rank = static_cast< std::size_t >( p / 100.0 * sorted.size() + 0.999999 );
+		return sorted[std::min( std::max< std::size_t >( rank, 1 ), sorted.size() ) - 1];
+	}
+
+	// What the window does for a drop: load, index, a query in each order, both
+	// with and without duplicates, and the export of the last one as text.
+	std::vector< pmm_lookupper::project > replay(std::vector< std::string > const& roots, pmm_lookupper::thread_pool& pool, std::size_t& exported)
+	{
+		auto projects = pmm_lookupper::crawl_projects( roots, pool );
+
+		pmm_lookupper::path_list paths;
+		for( auto const& p : projects ) {
+			paths.append( p.result.paths );
+		}
+
+		auto strings = std::make_shared< pmm_lookupper::string_pool >();
+		auto const ids = pmm_lookupper::intern_paths( paths, *strings );
+		pmm_lookupper::filter_engine engine( strings, ids );
+
+		auto opts = pmm_lookupper::to_query_options( pmm_lookupper::command_line_options() );
+		std::string text;
+		for( auto const order : { pmm_lookupper::sort_order::extension, pmm_lookupper::sort_order::input, pmm_lookupper::sort_order::path } ) {
+			for( auto const duplication : { true, false } ) {
+				opts.order = order;
+				opts.duplication = duplication;
+				auto const& rows = engine.query( opts );
+
+				text.clear();
+				for( auto const id : rows ) {
+					auto const s = ( *strings )[id];
+					text.append( s.data(), s.size() );
+					text += "\r\n";
+				}
+			}
+		}
+		exported = text.size();
+
+		return projects;
+	}
+
+	using metrics = std::map< std::string, double >;
+
+	bool read_baseline(std::string const& file, metrics& m)
+	{
+		std::ifstream ifs( file );
+		if( ifs.fail() ) {
+			return false;
+		}
+
+		std::string key;
+		double value;
+		while( ifs >> key >> value ) {
+			m[key] = value;
+		}
+
+		return true;
+	}
+
+	bool write_baseline(std::string const& file, metrics const& m)
+	{
+		std::ofstream ofs( file );
+		for( auto const& kv : m ) {
+			ofs << kv.first << ' ' << kv.second << '\n';
+		}
+
+		return !ofs.fail();
+	}
+
+} // namespace
+
+// bench_replay [--generate=N] [--runs=N] [--baseline=FILE] [--margin=PERCENT] [--save-baseline=FILE] corpus...
+// Replays the drop of a corpus headless and reports the wall time of the whole
+// pipeline, the latency of loading each project on its own, and peak RSS. With
+// --baseline, exits with 1 when any of these exceeds the stored value by more
+// than the margin (default 10%). --generate writes a synthetic corpus of N
+// scenes into the first directory, which must exist, before the run.
+int main(int argc, char** argv)
+{
+	std::vector< std::string > roots;
+	std::size_t generate = 0;
+	std::size_t runs = 3;
+	std::string baseline;
+	std::string save_baseline;
+	double margin = 10.0;
+
+	for( int i = 1; i < argc; ++i ) {
+		std::string const arg( argv[i] );
+		if( arg.compare( 0, 11, "--generate=" ) == 0 ) {
+			generate = std::strtoul( arg.c_str() + 11, nullptr, 10 );
+		}
+		else if( arg.compare( 0, 7, "--runs=" ) == 0 ) {
+			runs = std::max< std::size_t >( std::strtoul( arg.c_str() + 7, nullptr, 10 ), 1 );
+		}
+		else if( arg.compare( 0, 11, "--baseline=" ) == 0 ) {
+			baseline = arg.substr( 11 );
+		}
+		else if( arg.compare( 0, 9, "--margin=" ) == 0 ) {
+			margin = std::atof( arg.c_str() + 9 );
+		}
+		else if( arg.compare( 0, 16, "--save-baseline=" ) == 0 ) {
+			save_baseline = arg.substr( 16 );
+		}
+		else {
+			roots.push_back( arg );
+		}
+	}
+
+	if( roots.empty() ) {
+		std::fprintf( stderr, "usage: %s [--generate=N] [--runs=N] [--baseline=FILE] [--margin=PERCENT] [--save-baseline=FILE] corpus...\n", argv[0] );
+		return 2;
+	}
+	if( generate && !pmm_lookupper::bench::write_corpus( roots.front(), generate ) ) {
+		std::fprintf( stderr, "cannot write the corpus to %s\n", roots.front().c_str() );
+		return 2;
+	}
+
+	pmm_lookupper::thread_pool pool;
+
+	// The median run; the first one also warms the page cache.
+	std::vector< double > totals;
+	std::vector< pmm_lookupper::project > projects;
+	std::size_t exported = 0;
+	for( std::size_t i = 0; i < runs; ++i ) {
+		auto const t0 = clock_type::now();
+		projects = replay( roots, pool, exported );
+		totals.push_back( ms_since( t0 ) );
+	}
+	std::sort( totals.begin(), totals.end() );
+	auto const total_ms = totals[totals.size() / 2];
+
+	std::vector< double > latencies;
+	std::uint64_t bytes = 0;
+	for( auto const& p : projects ) {
+		auto const t0 = clock_type::now();
+		pmm_lookupper::load_file( p.file );
+		latencies.push_back( ms_since( t0 ) );
+
+		bytes += pmm_lookupper::get_file_status( p.file ).size;
+		if( pmm_lookupper::get_extension( p.file ) == ".pmm" ) {
+			auto const emm = pmm_lookupper::get_file_status( pmm_lookupper::detail::sibling_emm( p.file ) );
+			bytes += emm.exists ? emm.size : 0;
+		}
+	}
+	std::sort( latencies.begin(), latencies.end() );
+
+	metrics m;
+	m["total_ms"] = total_ms;
+	m["p50_ms"] = percentile( latencies, 50.0 );
+	m["p99_ms"] = percentile( latencies, 99.0 );
+	m["peak_rss_kb"] = static_cast< double >( peak_rss_kb() );
+
+	double const sec = total_ms / 1000.0;
+	std::printf( "projects     %zu\n", projects.size() );
+	std::printf( "input        %.1f MB\n", bytes / ( 1024.0 * 1024.0 ) );
+	std::printf( "exported     %.1f KB\n", exported / 1024.0 );
+	std::printf( "total        %.2f ms (median of %zu)\n", total_ms, runs );
+	std::printf( "throughput   %.1f MB/s %.0f projects/s\n", bytes / ( 1024.0 * 1024.0 ) / sec, projects.size() / sec );
+	std::printf( "per project  p50 %.3f ms p99 %.3f ms\n", m["p50_ms"], m["p99_ms"] );
+	std::printf( "peak rss     %.0f KB\n", m["peak_rss_kb"] );
+
+	if( !save_baseline.empty() && !write_baseline( save_baseline, m ) ) {
+		std::fprintf( stderr, "cannot write %s\n", save_baseline.c_str() );
+		return 2;
+	}
+
+	if( baseline.empty() ) {
+		return 0;
+	}
+
+	metrics base;
+	if( !read_baseline( baseline, base ) ) {
+		std::fprintf( stderr, "cannot read %s\n", baseline.c_str() );
+		return 2;
+	}
+
+	bool regressed = false;
+	for( auto const& kv : base ) {
+		auto const itr = m.find( kv.first );
+		if( itr == m.end() ) {
+			continue;
+		}
+
+		auto const limit = kv.second * ( 1.0 + margin / 100.0 );
+		if( itr->second > limit ) {
+			std::printf( "REGRESSION   %s %.3f > %.3f (baseline %.3f + %.0f%%)\n", kv.first.c_str(), itr->second, limit, kv.second, margin );
+			regressed = true;
+		}
+	}
+
+	return regressed ? 1 : 0;
+}
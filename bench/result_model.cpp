@@ -0,0 +1,93 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+#include "../src/result_model.hpp"
+
+namespace {
+
+	std::shared_ptr< pmm_lookupper::string_pool > make_pool(std::size_t rows, pmm_lookupper::id_list& ids)
+	{
+		std::mt19937 rng( 12345 );
+		std::uniform_int_distribution< int > digit( 0, 9 );
+
+		auto pool = std::make_shared< pmm_lookupper::string_pool >();
+		std::string path;
+		for( std::size_t i = 0; i < rows; ++i ) {
+			path = "C:\\MMD\\UserFile\\Model\\\xe8\xa1\xa8\xe7\xa4\xba\\";
+			for( int k = 0; k < 12; ++k ) {
+				path += static_cast< char >( '0' + digit( rng ) );
+			}
+			path += ".pmx";
+			ids.push_back( pool->intern( path ) );
+		}
+
+		return pool;
+	}
+
+	template <class F>
+	void run(char const* name, std::size_t rows, F f)
+	{
+		auto const t0 = std::chrono::steady_clock::now();
+		auto const n = f();
+		auto const t1 = std::chrono::steady_clock::now();
+
+		double const sec = std::chrono::duration< double >( t1 - t0 ).count();
+		std::printf( "%-8s %10.3f ms %12.0f rows/s %10zu chars\n", name, sec * 1000.0, rows / sec, n );
+	}
+
+} // namespace
+
+// Cost of showing a result: converting every row up front, as the list view
+// used to, against resetting the model and drawing pages of visible rows.
+int main(int argc, char** argv)
+{
+	std::size_t const rows = argc > 1 ? std::strtoul( argv[1], nullptr, 10 ) : 1000000;
+	std::size_t const visible = argc > 2 ? std::strtoul( argv[2], nullptr, 10 ) : 40;
+
+	pmm_lookupper::id_list ids;
+	auto const pool = make_pool( rows, ids );
+
+	run( "eager", rows, [&] {
+		std::vector< std::wstring > all;
+		all.reserve( ids.size() );
+		std::size_t n = 0;
+		for( auto const id : ids ) {
+			all.emplace_back();
+			pmm_lookupper::utf8_to_utf16( ( *pool )[id], all.back() );
+			n += all.back().size();
+		}
+		return n;
+	} );
+
+	pmm_lookupper::result_model model;
+	run( "reset", rows, [&] {
+		model.reset( pool, ids );
+		return std::size_t( 0 );
+	} );
+
+	run( "page", visible, [&] {
+		std::size_t n = 0;
+		model.prepare( 0, visible - 1 );
+		for( std::size_t i = 0; i < visible; ++i ) {
+			n += std::char_traits< wchar_t >::length( model.wide( i ) );
+		}
+		return n;
+	} );
+
+	run( "scroll", rows, [&] {
+		std::size_t n = 0;
+		for( std::size_t first = 0; first < model.size(); first += visible ) {
+			model.prepare( first, first + visible - 1 );
+			for( auto i = first; i < first + visible && i < model.size(); ++i ) {
+				n += std::char_traits< wchar_t >::length( model.wide( i ) );
+			}
+		}
+		return n;
+	} );
+
+	return 0;
+}
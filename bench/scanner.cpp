@@ -0,0 +1,109 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "../src/scanner.hpp"
+
+namespace {
+
+	std::vector< char > make_buffer(std::size_t size, std::size_t paths_per_mb)
+	{
+		std::mt19937 rng( 12345 );
+		std::uniform_int_distribution< int > byte( 0, 255 );
+
+		std::vector< char > buf( size );
+		for( auto& c : buf ) {
+			c = static_cast< char >( byte( rng ) );
+		}
+
+		std::string const path( "C:\\MMD\\UserFile\\Model\\\x95\x5c\x8e\xa6\\model.pmx" );
+		std::size_t const cnt = size / ( 1024 * 1024 ) * paths_per_mb + 1;
+		std::uniform_int_distribution< std::size_t > pos( 0, size - path.size() - 2 );
+
+		for( std::size_t i = 0; i < cnt; ++i ) {
+			auto const p = pos( rng );
+			buf[p] = '\0';
+			std::copy( path.begin(), path.end(), buf.begin() + p + 1 );
+			buf[p + 1 + path.size()] = '\0';
+		}
+
+		return buf;
+	}
+
+	std::size_t legacy_scan(std::vector< char > const& buf)
+	{
+		std::size_t n = 0;
+
+		for( auto itr = buf.begin(); itr != buf.end(); ++itr ) {
+			if( !pmm_lookupper::drive_letter_exists( itr, buf.end() ) ) {
+				continue;
+			}
+
+			auto last = std::find( itr, buf.end(), '\0' );
+			++n;
+
+			if( last == buf.end() ) {
+				break;
+			}
+			itr = last;
+		}
+
+		return n;
+	}
+
+	std::size_t kernel_scan(std::vector< char > const& buf)
+	{
+		std::size_t n = 0;
+		pmm_lookupper::for_each_file_path( boost::string_ref( buf.data(), buf.size() ), '\0', [&](boost::string_ref) {
+			++n;
+		} );
+
+		return n;
+	}
+
+	std::size_t stream_scan(std::vector< char > const& buf)
+	{
+		std::istringstream is( std::string( buf.begin(), buf.end() ) );
+
+		std::size_t n = 0;
+		pmm_lookupper::for_each_file_path( is, '\0', [&](boost::string_ref) {
+			++n;
+		} );
+
+		return n;
+	}
+
+	template <class F>
+	void run(char const* name, std::vector< char > const& buf, int iterations, F f)
+	{
+		std::size_t n = 0;
+
+		auto const t0 = std::chrono::steady_clock::now();
+		for( int i = 0; i < iterations; ++i ) {
+			n += f( buf );
+		}
+		auto const t1 = std::chrono::steady_clock::now();
+
+		double const sec = std::chrono::duration< double >( t1 - t0 ).count();
+		double const mb = static_cast< double >( buf.size() ) * iterations / ( 1024.0 * 1024.0 );
+		std::printf( "%-8s %10.1f MB/s %10zu paths\n", name, mb / sec, n / iterations );
+	}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+	std::size_t const size = ( argc > 1 ? std::strtoul( argv[1], nullptr, 10 ) : 64 ) * 1024 * 1024;
+	int const iterations = argc > 2 ? std::atoi( argv[2] ) : 5;
+
+	auto const buf = make_buffer( size, 64 );
+
+	run( "legacy", buf, iterations, &legacy_scan );
+	run( "kernel", buf, iterations, &kernel_scan );
+	run( "stream", buf, iterations, &stream_scan );
+
+	return 0;
+}
@@ -0,0 +1,141 @@
+#include <cstdio>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "engine.hpp"
+#include "options.hpp"
+#include "pipeline_stats.hpp"
+#include "query.hpp"
+#include "verify.hpp"
+
+namespace {
+
+	// Each project with its assets marked "OK" or "MISSING", then the totals.
+	// Returns true when no asset is missing.
+	bool print_verify_report(pmm_lookupper::verify_report const& report, pmm_lookupper::string_pool const& strings)
+	{
+		for( auto const& p : report.projects ) {
+			std::cout << "== " << p.file << '\n';
+			for( auto const& a : p.assets ) {
+				if( a.present ) {
+					std::cout << "OK\t" << a.size << '\t' << strings[a.path] << '\n';
+				}
+				else {
+					std::cout << "MISSING\t\t" << strings[a.path] << '\n';
+				}
+			}
+			std::cout << "-- " << p.assets.size() - p.missing << " present (" << p.present_bytes << " bytes), "
+				<< p.missing << " missing\n";
+		}
+		std::cout << "== total: " << report.assets << " assets, " << report.assets - report.missing << " present ("
+			<< report.present_bytes << " bytes), " << report.missing << " missing\n";
+
+		return report.missing == 0;
+	}
+
+	// Collects stats for the rest of the run and writes them to stderr as one
+	// line of JSON when it ends.
+	class stats_report
+	{
+		pmm_lookupper::pipeline_stats stats_;
+
+	public:
+		stats_report()
+		{
+			pmm_lookupper::install_pipeline_stats( &stats_ );
+		}
+
+		stats_report(stats_report const&) = delete;
+		stats_report& operator=(stats_report const&) = delete;
+
+		~stats_report()
+		{
+			pmm_lookupper::install_pipeline_stats( nullptr );
+			std::cerr << stats_.to_json() << std::endl;
+		}
+	};
+
+} // namespace
+
+// Console front end: pmm_lookupper_cli [-e "exts"] [-d] [-f] [-s path|ext|input] [--cache=FILE] [--verify] [--stats=json] files or folders...
+// Results are written to stdout as UTF-8, one path per line. With --verify, the
+// assets of each project are checked instead and 3 is returned when any is missing.
+// --stats=json writes the counters and stage latencies of the run to stderr.
+int main(int argc, char** argv)
+{
+	try {
+		auto const opts = pmm_lookupper::parse_command_line_options( std::vector< std::string >( argv, argv + argc ) );
+		if( opts.files.empty() || ( opts.stats && *opts.stats != "json" ) ) {
+			std::cerr << "usage: " << argv[0] << " [-e \"pmx fx ...\"] [-d] [-f] [-s path|ext|input] [--cache=FILE] [--verify] [--stats=json] files..." << std::endl;
+			return 2;
+		}
+
+		std::unique_ptr< stats_report > report;
+		if( opts.stats ) {
+			report.reset( new stats_report() );
+		}
+
+		std::unique_ptr< pmm_lookupper::scan_cache > cache;
+		if( opts.cache ) {
+			cache.reset( new pmm_lookupper::scan_cache( *opts.cache ) );
+		}
+
+		pmm_lookupper::thread_pool pool;
+		if( opts.verify ) {
+			auto const projects = pmm_lookupper::crawl_projects( opts.files, pool, cache.get() );
+			if( cache && !cache->save() ) {
+				std::cerr << "キャッシュを保存できませんでした: " << cache->file() << '\n';
+			}
+
+			bool errors = false;
+			for( auto const& p : projects ) {
+				if( p.result.error ) {
+					std::cerr << "読み込めないファイルがありました: " << p.file << '\n';
+					errors = true;
+				}
+			}
+
+			std::ios::sync_with_stdio( false );
+			pmm_lookupper::string_pool strings;
+			pmm_lookupper::stat_cache stats( pool );
+			auto const report = pmm_lookupper::verify_assets(
+				projects, pmm_lookupper::to_query_options( opts ).extensions, strings, stats
+			);
+			auto const complete = print_verify_report( report, strings );
+			std::cout.flush();
+
+			return !complete ? 3 : errors ? 1 : 0;
+		}
+
+		auto const loaded = pmm_lookupper::crawl_files( opts.files, pool, cache.get() );
+
+		if( cache && !cache->save() ) {
+			std::cerr << "キャッシュを保存できませんでした: " << cache->file() << '\n';
+		}
+
+		for( auto const& e : loaded.errors ) {
+			std::cerr << "読み込めないファイルがありました: " << e << '\n';
+		}
+
+		std::ios::sync_with_stdio( false );
+		pmm_lookupper::string_pool strings;
+		auto const ids = pmm_lookupper::intern_paths( loaded.paths, strings );
+		pmm_lookupper::stage_timer index_timer( pmm_lookupper::stat_stage::index );
+		pmm_lookupper::sort_keys const keys( strings );
+		pmm_lookupper::path_aliases const aliases( ids, strings );
+		index_timer.stop();
+		pmm_lookupper::stat_cache stats( pool );
+		for( auto const id : pmm_lookupper::run_query( ids, strings, keys, aliases, pmm_lookupper::to_query_options( opts ), &stats ) ) {
+			std::cout << strings[id] << '\n';
+		}
+		std::cout.flush();
+
+		return loaded.errors.empty() ? 0 : 1;
+	}
+	catch( std::exception const& e ) {
+		std::cerr << "エラー: " << e.what() << std::endl;
+		return 2;
+	}
+}
@@ -0,0 +1,39 @@
+#ifndef PMM_LOOKUPPER_CANCEL_TOKEN_HPP_
+#define PMM_LOOKUPPER_CANCEL_TOKEN_HPP_
+
+#include <atomic>
+#include <memory>
+
+namespace pmm_lookupper {
+
+	// A flag through which the caller of a job stops it. Copies share the flag, so
+	// the job polls the copy it was given while the caller keeps another.
+	class cancel_token
+	{
+		std::shared_ptr< std::atomic< bool > > flag_;
+
+	public:
+		cancel_token() :
+			flag_( std::make_shared< std::atomic< bool > >( false ) )
+		{ }
+
+		inline void cancel() noexcept
+		{
+			flag_->store( true, std::memory_order_relaxed );
+		}
+
+		inline bool cancelled() const noexcept
+		{
+			return flag_->load( std::memory_order_relaxed );
+		}
+	};
+
+	// For jobs taking an optional token.
+	inline bool is_cancelled(cancel_token const* token) noexcept
+	{
+		return token && token->cancelled();
+	}
+
+} // namespace pmm_lookupper
+
+#endif // PMM_LOOKUPPER_CANCEL_TOKEN_HPP_
@@ -3,46 +3,28 @@
 
 #include "winapi.hpp"
 #include "main_window.hpp"
+#include "options.hpp"
 
 namespace pmm_lookupper {
 
 	inline void parse_command_line(main_window& wnd)
 	{
-		auto const argv = get_command_line();
-		std::vector< std::string > files;
+		auto const opts = parse_command_line_options( get_command_line(), flag_match::anywhere );
 
-		for( std::size_t i = 1; i < argv.size(); ++i ) {
-			if( argv[i].find( "-d" ) != argv[i].npos ) {
-				CheckDlgButton( wnd.handle(), IDC_DUPLICATION, BST_CHECKED );
-			}
-			else if( argv[i].find( "-f" ) != argv[i].npos ) {
-				CheckDlgButton( wnd.handle(), IDC_FOLDER_ONLY, BST_CHECKED );
-			}
-			else if( argv[i].find( "-e" ) != argv[i].npos ) {
-				if( i + 1 == argv.size() ) {
-					break;
-				}
-				set_window_text( GetDlgItem( wnd.handle(), IDC_EXTFILTER ), argv[i + 1] );
-				++i;
-			}
-			else if( argv[i].find( "-s" ) != argv[i].npos ) {
-				if( i + 1 == argv.size() ) {
-					break;
-				}
-				if( argv[i + 1] == "path" ) {
-					cb_set_cursel( GetDlgItem( wnd.handle(), IDC_SORT_COND ), 0 );
-				}
-				else if( argv[i + 1] == "ext" ) {
-					cb_set_cursel( GetDlgItem( wnd.handle(), IDC_SORT_COND ), 1 );
-				}
-				++i;
-			}
-			else {
-				files.push_back( argv[i] );
-			}
+		if( opts.duplication ) {
+			CheckDlgButton( wnd.handle(), IDC_DUPLICATION, BST_CHECKED );
+		}
+		if( opts.folder_only ) {
+			CheckDlgButton( wnd.handle(), IDC_FOLDER_ONLY, BST_CHECKED );
+		}
+		if( opts.extensions ) {
+			set_window_text( GetDlgItem( wnd.handle(), IDC_EXTFILTER ), *opts.extensions );
+		}
+		if( opts.order ) {
+			cb_set_cursel( GetDlgItem( wnd.handle(), IDC_SORT_COND ), main_window::sort_order_index( *opts.order ) );
 		}
 
-		wnd.refresh( files );
+		wnd.refresh( opts.files );
 	}
 
 } // namespace pmm_lookupper
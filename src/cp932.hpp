@@ -0,0 +1,144 @@
+#ifndef PMM_LOOKUPPER_CP932_HPP_
+#define PMM_LOOKUPPER_CP932_HPP_
+
+#include <string>
+#include <cstddef>
+#include <cstdint>
+#include <boost/utility/string_ref.hpp>
+#include "cp932_table.hpp"
+
+// PMM_LOOKUPPER_CP932_NO_SSE2 builds the plain loop alone, as a target without
+// SSE2 gets it.
+#if defined( __SSE2__ ) && !defined( PMM_LOOKUPPER_CP932_NO_SSE2 )
+#	include <emmintrin.h>
+#	define PMM_LOOKUPPER_CP932_SSE2
+#endif
+
+namespace pmm_lookupper { namespace cp932 {
+
+	// What MultiByteToWideChar produces for bytes it cannot map.
+	std::uint32_t const default_char = 0x30fb;
+
+	inline constexpr bool is_lead(unsigned char c) noexcept
+	{
+		return ( c >= 0x81 && c <= 0x9f ) || ( c >= 0xe0 && c <= 0xfc );
+	}
+
+	inline constexpr bool is_trail(unsigned char c) noexcept
+	{
+		return c >= 0x40 && c <= 0xfc && c != 0x7f;
+	}
+
+	inline constexpr std::size_t lead_index(unsigned char c) noexcept
+	{
+		return c <= 0x9f ? c - 0x81 : c - 0xe0 + 0x1f;
+	}
+
+	inline constexpr std::size_t trail_index(unsigned char c) noexcept
+	{
+		return c < 0x7f ? c - 0x40 : c - 0x41;
+	}
+
+	inline constexpr std::uint32_t single_byte(unsigned char c) noexcept
+	{
+		return c < 0x80 ? c
+			: c == 0x80 ? 0x80
+			: c == 0xa0 ? 0xf8f0
+			: c >= 0xa1 && c <= 0xdf ? 0xff61 + ( c - 0xa1 )
+			: c >= 0xfd ? 0xf8f1 + ( c - 0xfd )
+			: default_char;
+	}
+
+	inline std::uint32_t double_byte(unsigned char lead, unsigned char trail) noexcept
+	{
+		auto const u = double_byte_table[lead_index( lead ) * trail_count + trail_index( trail )];
+		return u ? u : default_char;
+	}
+
+	inline char* put_utf8(std::uint32_t u, char* p) noexcept
+	{
+		if( u < 0x80 ) {
+			*p++ = static_cast< char >( u );
+		}
+		else if( u < 0x800 ) {
+			*p++ = static_cast< char >( 0xc0 | ( u >> 6 ) );
+			*p++ = static_cast< char >( 0x80 | ( u & 0x3f ) );
+		}
+		else {
+			*p++ = static_cast< char >( 0xe0 | ( u >> 12 ) );
+			*p++ = static_cast< char >( 0x80 | ( ( u >> 6 ) & 0x3f ) );
+			*p++ = static_cast< char >( 0x80 | ( u & 0x3f ) );
+		}
+
+		return p;
+	}
+
+} // namespace cp932
+
+	// Every CP932 byte becomes at most three bytes of UTF-8.
+	inline constexpr std::size_t utf8_capacity(std::size_t n) noexcept
+	{
+		return n * 3;
+	}
+
+	// Writes the UTF-8 form of src to dest, which must hold utf8_capacity( src.size() )
+	// bytes, and returns the end of the output.
+	inline char* cp932_to_utf8(boost::string_ref src, char* dest) noexcept
+	{
+		auto p = reinterpret_cast< unsigned char const* >( src.data() );
+		auto const last = p + src.size();
+
+		while( p != last ) {
+#if defined( PMM_LOOKUPPER_CP932_SSE2 )
+			while( last - p >= 16 ) {
+				__m128i const v = _mm_loadu_si128( reinterpret_cast< __m128i const* >( p ) );
+				if( _mm_movemask_epi8( v ) != 0 ) {
+					break;
+				}
+				_mm_storeu_si128( reinterpret_cast< __m128i* >( dest ), v );
+				p += 16;
+				dest += 16;
+			}
+			if( p == last ) {
+				break;
+			}
+#endif
+			auto const c = *p++;
+			if( c < 0x80 ) {
+				*dest++ = static_cast< char >( c );
+			}
+			else if( !cp932::is_lead( c ) ) {
+				dest = cp932::put_utf8( cp932::single_byte( c ), dest );
+			}
+			else if( p != last && cp932::is_trail( *p ) ) {
+				dest = cp932::put_utf8( cp932::double_byte( c, *p ), dest );
+				++p;
+			}
+			else {
+				dest = cp932::put_utf8( cp932::default_char, dest );
+			}
+		}
+
+		return dest;
+	}
+
+	inline void cp932_to_utf8(boost::string_ref src, std::string& dest)
+	{
+		auto const offset = dest.size();
+		dest.resize( offset + utf8_capacity( src.size() ) );
+
+		auto const last = cp932_to_utf8( src, &dest[0] + offset );
+		dest.resize( last - dest.data() );
+	}
+
+	inline std::string cp932_to_utf8(boost::string_ref src)
+	{
+		std::string result;
+		cp932_to_utf8( src, result );
+
+		return result;
+	}
+
+} // namespace pmm_lookupper
+
+#endif // PMM_LOOKUPPER_CP932_HPP_
@@ -1,43 +1,98 @@
 #ifndef PMM_LOOKUPPER_EMM_HPP_
 #define PMM_LOOKUPPER_EMM_HPP_
 
-#include <fstream>
 #include <string>
 #include <vector>
-#include <boost/range/algorithm.hpp>
+#include <boost/optional.hpp>
 #include <boost/utility/string_ref.hpp>
 #include "file.hpp"
 #include "filter.hpp"
 
 namespace pmm_lookupper {
 
-	inline bool is_emm_file(boost::string_ref path) 
+	inline bool is_emm_file(boost::string_ref buf) noexcept
 	{
-		std::ifstream ifs( convert_code( path, CP_UTF8, CP_OEMCP ), std::ios::binary );
-		if( ifs.fail() ) {
-			return false;
+		return buf.starts_with( "[Info]\r\nVersion = 3\r\n" );
+	}
+
+	// Effect assignments are the "key = X:\...\*.fx" lines of every section but
+	// [Info] and [Object], which offscreen render targets add under names of their
+	// own.
+	inline std::vector< path_span > emm_path_spans(boost::string_ref buf)
+	{
+		std::vector< std::string > const exts = {
+			std::string( ".fx" ),
+			std::string( ".fxsub" )
+		};
+
+		std::vector< path_span > result;
+		bool in_effect = false;
+		auto const is_effect_section = [](boost::string_ref line) {
+			return !line.starts_with( "[Info]" ) && !line.starts_with( "[Object]" );
+		};
+
+		auto const is_eol = [](char c) { return c == '\r' || c == '\n'; };
+
+		for( auto itr = buf.begin(); itr != buf.end(); ) {
+			auto const eol = std::find_if( itr, buf.end(), is_eol );
+			boost::string_ref const line( itr, eol - itr );
+			itr = eol == buf.end() ? eol : eol + 1;
+
+			if( line.starts_with( '[' ) ) {
+				in_effect = is_effect_section( line );
+				continue;
+			}
+			if( !in_effect ) {
+				continue;
+			}
+
+			auto const eq = line.find( '=' );
+			if( eq == line.npos ) {
+				continue;
+			}
+
+			char const* const last = line.data() + line.size();
+			auto const letter = find_drive_letter( line.data(), line.data() + eq + 1, last );
+			if( letter == last ) {
+				continue;
+			}
+
+			boost::string_ref const path( letter, last - letter );
+			if( has_extension( path, exts ) ) {
+				result.push_back( { static_cast< std::size_t >( letter - buf.data() ), path.size() } );
+			}
+		}
+
+		return result;
+	}
+
+	// Opens the file once; none when it is not an EMM file.
+	inline boost::optional< path_list > parse_emm_buffer(boost::string_ref buf)
+	{
+		if( !is_emm_file( buf ) ) {
+			return boost::none;
 		}
 
-		std::istreambuf_iterator< char > first( ifs ), last;
-		boost::string_ref const seg( "[Info]\r\nVersion = 3\r\n" );
+		path_list result;
+		result.append( buf, emm_path_spans( buf ) );
 
-		return std::search( first, last, seg.begin(), seg.end() ) != last;
+		return result;
 	}
 
-	inline std::vector< std::string > emm_contain_file_paths(boost::string_ref path)
+	inline boost::optional< path_list > parse_emm_file(boost::string_ref path)
 	{
-		auto const buf = read_file( path );
-		if( buf.empty() ) {
+		auto const file = map_file( path );
+		return parse_emm_buffer( file.range() );
+	}
+
+	inline path_list emm_contain_file_paths(boost::string_ref path)
+	{
+		auto result = parse_emm_file( path );
+		if( !result ) {
 			return {};
 		}
 
-		std::vector< std::string > const exts = {
-			std::string( "fx" ),
-			std::string( "fxsub" )
-		};
-
-		auto const result = find_file_paths( buf, '\r' );
-		return match_extension( result, exts );
+		return std::move( *result );
 	}
 
 } // namespace pmm_lookupper
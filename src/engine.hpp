@@ -0,0 +1,584 @@
+#ifndef PMM_LOOKUPPER_ENGINE_HPP_
+#define PMM_LOOKUPPER_ENGINE_HPP_
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <map>
+#include <mutex>
+#include <string>
+#include <tuple>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+#include <boost/optional.hpp>
+#include "pmm.hpp"
+#include "emm.hpp"
+#include "cancel_token.hpp"
+#include "filter.hpp"
+#include "filesystem.hpp"
+#include "hash.hpp"
+#include "mapped_file.hpp"
+#include "path_list.hpp"
+#include "pipeline_stats.hpp"
+#include "scan_cache.hpp"
+#include "thread_pool.hpp"
+
+namespace pmm_lookupper {
+
+	struct file_result
+	{
+		path_list paths;
+		bool error;
+	};
+
+	struct load_result
+	{
+		path_list paths;
+		std::vector< std::string > errors;
+	};
+
+	// One input file with the paths found in it.
+	struct project
+	{
+		std::string file;
+		file_result result;
+	};
+
+	// Lets the caller of a load stop and follow it. progress( done, total ) counts
+	// the files scanned and is called from pool workers. A cancelled load skips
+	// whatever it has not started; its result is to be discarded.
+	struct load_monitor
+	{
+		cancel_token cancel;
+		std::function< void(std::size_t, std::size_t) > progress;
+
+		inline bool cancelled() const noexcept
+		{
+			return cancel.cancelled();
+		}
+	};
+
+namespace detail {
+
+	template <class F>
+	inline boost::optional< path_list > scan_file(std::string const& file, scan_cache* cache, F parse)
+	{
+		if( cache ) {
+			return cache->scan( file, parse );
+		}
+
+		auto const f = map_file( file );
+		return parse( f.range() );
+	}
+
+	inline std::string sibling_emm(std::string const& pmm)
+	{
+		return pmm.substr( 0, pmm.find_last_of( '.' ) ) + ".emm";
+	}
+
+	inline file_result make_file_result(
+		std::string const& ext, boost::optional< path_list > const* first, boost::optional< path_list > const* second
+	) {
+		file_result result;
+		result.error = false;
+
+		if( ext == ".pmm" ) {
+			if( *first ) {
+				result.paths = **first;
+			}
+			result.error = result.paths.empty();
+			if( *second ) {
+				result.paths.append( **second );
+			}
+		}
+		else if( ext == ".emm" && *first ) {
+			result.paths = **first;
+		}
+		else {
+			result.error = true;
+		}
+
+		return result;
+	}
+
+} // namespace detail
+
+	// A .pmm contributes its own paths followed by those of the .emm next to it.
+	// Files are looked up in cache first when one is given.
+	inline file_result load_file(std::string const& file, scan_cache* cache = nullptr)
+	{
+		auto const ext = get_extension( file );
+
+		boost::optional< path_list > first, second;
+		if( ext == ".pmm" ) {
+			first = detail::scan_file( file, cache, &parse_pmm_buffer );
+			second = detail::scan_file( detail::sibling_emm( file ), cache, &parse_emm_buffer );
+		}
+		else if( ext == ".emm" ) {
+			first = detail::scan_file( file, cache, &parse_emm_buffer );
+		}
+
+		return detail::make_file_result( ext, &first, &second );
+	}
+
+namespace detail {
+
+	struct scan_target
+	{
+		std::string path;
+		bool pmm;
+	};
+
+	inline boost::optional< path_list > parse_target(scan_target const& t, boost::string_ref buf)
+	{
+		stage_timer timer( stat_stage::scan );
+		auto result = t.pmm ? parse_pmm_buffer( buf ) : parse_emm_buffer( buf );
+		if( timer.active() && result ) {
+			count_stat( stat_counter::candidates, result->size() );
+		}
+
+		return result;
+	}
+
+	inline boost::optional< path_list > parse_streamed_target(scan_target const& t, std::uint64_t size)
+	{
+		stage_timer timer( stat_stage::scan );
+		count_stat( stat_counter::files_read, 1 );
+		count_stat( stat_counter::bytes_read, size );
+		auto result = parse_pmm_stream( t.path );
+		if( timer.active() && result ) {
+			count_stat( stat_counter::candidates, result->size() );
+		}
+
+		return result;
+	}
+
+	inline std::uint64_t read_content(boost::string_ref buf)
+	{
+		stage_timer timer( stat_stage::read );
+		count_stat( stat_counter::files_read, 1 );
+		count_stat( stat_counter::bytes_read, buf.size() );
+
+		return hash_content( buf );
+	}
+
+	// Scans every target once per distinct content. Only files whose size occurs
+	// more than once in the batch are hashed; of each group with equal size and
+	// hash the first is parsed and its result is copied to the others, unless the
+	// first changed after it was hashed, in which case each is parsed. A .pmm of
+	// pmm_stream_size or more is streamed on its own, bypassing the cache.
+	inline std::vector< boost::optional< path_list > > scan_targets(
+		std::vector< scan_target > const& targets, thread_pool& pool, scan_cache* cache, load_monitor* monitor
+	) {
+		auto const n = targets.size();
+		std::vector< boost::optional< path_list > > results( n );
+		std::vector< file_status > status( n );
+		std::vector< char > done( n, 0 );
+
+		std::atomic< std::size_t > finished( 0 );
+		auto const advance = [&](std::size_t k) {
+			auto const cnt = finished += k;
+			if( monitor && monitor->progress ) {
+				monitor->progress( cnt, n );
+			}
+		};
+		auto const cancelled = [monitor] {
+			return monitor && monitor->cancelled();
+		};
+
+		parallel_for( pool, n, [&](std::size_t i) {
+			if( cancelled() ) {
+				return;
+			}
+
+			status[i] = get_file_status( targets[i].path );
+			if( !status[i].exists || status[i].is_directory ) {
+				if( cache ) {
+					cache->forget( targets[i].path );
+				}
+				done[i] = 1;
+			}
+			else if( cache && cache->find( targets[i].path, status[i], results[i] ) ) {
+				done[i] = 1;
+			}
+			else if( targets[i].pmm && status[i].size >= pmm_stream_size ) {
+				results[i] = parse_streamed_target( targets[i], status[i].size );
+				done[i] = 1;
+			}
+
+			if( done[i] ) {
+				advance( 1 );
+			}
+		} );
+
+		std::unordered_map< std::uint64_t, std::size_t > sizes;
+		for( std::size_t i = 0; i < n; ++i ) {
+			if( !done[i] ) {
+				++sizes[status[i].size];
+			}
+		}
+
+		std::vector< std::uint64_t > hashes( n );
+		std::vector< char > hashed( n, 0 );
+		std::vector< char > changed( n, 0 );
+		parallel_for( pool, n, [&](std::size_t i) {
+			if( cancelled() || done[i] || sizes.find( status[i].size )->second < 2 ) {
+				return;
+			}
+
+			auto const file = map_file( targets[i].path );
+			if( !file ) {
+				done[i] = 1;
+				advance( 1 );
+				return;
+			}
+			hashes[i] = read_content( file.range() );
+			hashed[i] = 1;
+		} );
+
+		if( cancelled() ) {
+			return results;
+		}
+
+		// Each owner counts the files it is scanned for, itself included.
+		std::vector< std::size_t > owner( n );
+		std::vector< std::size_t > members( n, 0 );
+		std::map< std::tuple< bool, std::uint64_t, std::uint64_t >, std::size_t > firsts;
+		for( std::size_t i = 0; i < n; ++i ) {
+			owner[i] = i;
+			if( hashed[i] ) {
+				owner[i] = firsts.emplace( std::make_tuple( targets[i].pmm, status[i].size, hashes[i] ), i ).first->second;
+			}
+			if( !done[i] ) {
+				++members[owner[i]];
+			}
+		}
+
+		parallel_for( pool, n, [&](std::size_t i) {
+			if( cancelled() || done[i] || owner[i] != i ) {
+				return;
+			}
+
+			auto const file = map_file( targets[i].path );
+			if( !file ) {
+				done[i] = 1;
+				advance( members[i] );
+				return;
+			}
+
+			// Hashed again from the mapping that is parsed, so that a file changed
+			// since it was grouped is neither stored under its old hash nor shared.
+			if( hashed[i] ) {
+				auto const hash = hash_content( file.range() );
+				changed[i] = hash != hashes[i];
+				hashes[i] = hash;
+				status[i].size = file.size();
+			}
+
+			if( !cache ) {
+				if( !hashed[i] ) {
+					count_stat( stat_counter::files_read, 1 );
+					count_stat( stat_counter::bytes_read, file.size() );
+				}
+				results[i] = parse_target( targets[i], file.range() );
+				advance( members[i] );
+				return;
+			}
+
+			if( !hashed[i] ) {
+				hashes[i] = read_content( file.range() );
+			}
+			if( !cache->find_content( file.size(), hashes[i], results[i] ) ) {
+				results[i] = parse_target( targets[i], file.range() );
+			}
+			cache->store( targets[i].path, status[i], hashes[i], results[i] );
+			advance( members[i] );
+		} );
+
+		if( cancelled() ) {
+			return results;
+		}
+
+		for( std::size_t i = 0; i < n; ++i ) {
+			if( done[i] || owner[i] == i ) {
+				continue;
+			}
+
+			if( changed[owner[i]] ) {
+				auto const file = map_file( targets[i].path );
+				if( !file ) {
+					continue;
+				}
+				hashes[i] = hash_content( file.range() );
+				status[i].size = file.size();
+				results[i] = parse_target( targets[i], file.range() );
+			}
+			else {
+				results[i] = results[owner[i]];
+			}
+			if( cache ) {
+				cache->store( targets[i].path, status[i], hashes[i], results[i] );
+			}
+		}
+
+		return results;
+	}
+
+	// Loads files as load_file would, but scans each distinct content only once.
+	inline std::vector< file_result > load_batch(
+		std::vector< std::string > const& files, thread_pool& pool, scan_cache* cache, load_monitor* monitor = nullptr
+	) {
+		std::vector< scan_target > targets;
+		std::vector< std::size_t > first( files.size() );
+		for( std::size_t i = 0; i < files.size(); ++i ) {
+			first[i] = targets.size();
+
+			auto const ext = get_extension( files[i] );
+			if( ext == ".pmm" ) {
+				targets.push_back( { files[i], true } );
+				targets.push_back( { sibling_emm( files[i] ), false } );
+			}
+			else if( ext == ".emm" ) {
+				targets.push_back( { files[i], false } );
+			}
+		}
+
+		auto const scanned = scan_targets( targets, pool, cache, monitor );
+
+		boost::optional< path_list > const none;
+		std::vector< file_result > results;
+		results.reserve( files.size() );
+		for( std::size_t i = 0; i < files.size(); ++i ) {
+			auto const cnt = ( i + 1 < files.size() ? first[i + 1] : targets.size() ) - first[i];
+			results.push_back( make_file_result(
+				get_extension( files[i] ),
+				cnt > 0 ? &scanned[first[i]] : &none,
+				cnt > 1 ? &scanned[first[i] + 1] : &none
+			) );
+		}
+
+		if( installed_pipeline_stats() ) {
+			std::size_t emitted = 0;
+			for( auto const& r : results ) {
+				emitted += r.paths.size();
+			}
+			count_stat( stat_counter::paths_emitted, emitted );
+		}
+
+		return results;
+	}
+
+} // namespace detail
+
+	// Loads every file on the pool. Paths and errors are merged in input order, so
+	// the result does not depend on scheduling.
+	inline load_result load_files(std::vector< std::string > const& files, thread_pool& pool, scan_cache* cache = nullptr)
+	{
+		auto const results = detail::load_batch( files, pool, cache );
+
+		load_result result;
+		for( std::size_t i = 0; i < files.size(); ++i ) {
+			result.paths.append( results[i].paths );
+			if( results[i].error ) {
+				result.errors.push_back( files[i] );
+			}
+		}
+
+		return result;
+	}
+
+namespace detail {
+
+	// Files found by a crawl are scanned in batches of this many while it goes on.
+	std::size_t const crawl_batch_size = 256;
+
+	// found holds each file with its index in the order of discovery, in which
+	// unscanned hands them out. running counts the directories being listed.
+	struct crawl_state
+	{
+		load_monitor* monitor;
+		std::mutex mtx;
+		std::condition_variable cv;
+		std::vector< std::vector< std::pair< std::string, std::size_t > > > found;
+		std::vector< std::string > unscanned;
+		std::size_t discovered;
+		std::size_t running;
+
+		void add(std::size_t root, std::string const& path)
+		{
+			std::lock_guard< std::mutex > lock( mtx );
+			found[root].emplace_back( path, discovered++ );
+			unscanned.push_back( path );
+			if( unscanned.size() == crawl_batch_size ) {
+				cv.notify_one();
+			}
+		}
+	};
+
+	inline void crawl_directory(task_group& group, crawl_state& st, std::size_t root, std::string const& dir);
+
+	inline void spawn_crawl(task_group& group, crawl_state& st, std::size_t root, std::string const& dir)
+	{
+		struct finish_guard
+		{
+			crawl_state& st;
+
+			~finish_guard()
+			{
+				std::lock_guard< std::mutex > lock( st.mtx );
+				if( --st.running == 0 ) {
+					st.cv.notify_one();
+				}
+			}
+		};
+
+		{
+			std::lock_guard< std::mutex > lock( st.mtx );
+			++st.running;
+		}
+		group.run( [&group, &st, root, dir] {
+			finish_guard guard{ st };
+			crawl_directory( group, st, root, dir );
+		} );
+	}
+
+	inline void crawl_directory(task_group& group, crawl_state& st, std::size_t root, std::string const& dir)
+	{
+		if( st.monitor && st.monitor->cancelled() ) {
+			return;
+		}
+
+		std::vector< directory_entry > entries;
+		// An unreadable directory is passed on as a file and reported as an error.
+		if( !list_directory( dir, entries ) ) {
+			st.add( root, dir );
+			return;
+		}
+
+		std::unordered_set< std::string > files;
+		for( auto const& e : entries ) {
+			if( !e.is_directory ) {
+				files.insert( e.name );
+			}
+		}
+
+		for( auto const& e : entries ) {
+			auto const path = join_path( dir, e.name );
+
+			if( e.is_directory ) {
+				spawn_crawl( group, st, root, path );
+				continue;
+			}
+
+			// An .emm next to a .pmm is read together with it.
+			auto const ext = get_extension( e.name );
+			if( ext == ".pmm" || ( ext == ".emm" && !files.count( e.name.substr( 0, e.name.size() - 4 ) + ".pmm" ) ) ) {
+				st.add( root, path );
+			}
+		}
+	}
+
+} // namespace detail
+
+	// The .pmm and .emm files among roots, directories searched recursively and
+	// their files in path order, each loaded as load_file would. Files are scanned
+	// in batches while the crawl goes on, so identical copies are scanned once per
+	// batch rather than once per tree. Progress counts the files found so far.
+	inline std::vector< project > crawl_projects(
+		std::vector< std::string > const& roots, thread_pool& pool, scan_cache* cache = nullptr, load_monitor* monitor = nullptr
+	) {
+		detail::crawl_state st;
+		st.monitor = monitor;
+		st.found.resize( roots.size() );
+		st.discovered = 0;
+		st.running = 0;
+
+		// Progress of a batch is offset by the targets of the batches before it.
+		std::vector< file_result > loaded;
+		std::size_t targets_before = 0;
+		std::atomic< std::size_t > batch_targets( 0 );
+		load_monitor batch_monitor;
+		if( monitor ) {
+			batch_monitor.cancel = monitor->cancel;
+			if( monitor->progress ) {
+				batch_monitor.progress = [monitor, &targets_before, &batch_targets](std::size_t done, std::size_t total) {
+					batch_targets = total;
+					monitor->progress( targets_before + done, targets_before + total );
+				};
+			}
+		}
+
+		{
+			task_group group( pool );
+			for( std::size_t i = 0; i < roots.size(); ++i ) {
+				auto const& root = roots[i];
+				if( is_directory( root ) ) {
+					detail::spawn_crawl( group, st, i, root );
+				}
+				else {
+					st.add( i, root );
+				}
+			}
+
+			// Batches are taken in the order of discovery, so loaded follows it.
+			for( ;; ) {
+				std::vector< std::string > batch;
+				{
+					std::unique_lock< std::mutex > lock( st.mtx );
+					st.cv.wait( lock, [&st] {
+						return st.unscanned.size() >= detail::crawl_batch_size || st.running == 0;
+					} );
+					if( st.unscanned.empty() ) {
+						break;
+					}
+					batch.swap( st.unscanned );
+				}
+
+				batch_targets = 0;
+				auto results = detail::load_batch( batch, pool, cache, monitor ? &batch_monitor : nullptr );
+				std::move( results.begin(), results.end(), std::back_inserter( loaded ) );
+				targets_before += batch_targets;
+			}
+			group.wait();
+		}
+
+		if( monitor && monitor->cancelled() ) {
+			return {};
+		}
+
+		std::vector< project > projects;
+		projects.reserve( loaded.size() );
+		for( auto& found : st.found ) {
+			std::sort( found.begin(), found.end() );
+			for( auto& f : found ) {
+				projects.push_back( { std::move( f.first ), std::move( loaded[f.second] ) } );
+			}
+		}
+
+		return projects;
+	}
+
+	// Like load_files, but a directory among the inputs is searched recursively for
+	// .pmm and .emm files, which are merged in path order.
+	inline load_result crawl_files(
+		std::vector< std::string > const& roots, thread_pool& pool, scan_cache* cache = nullptr, load_monitor* monitor = nullptr
+	) {
+		load_result result;
+		for( auto const& p : crawl_projects( roots, pool, cache, monitor ) ) {
+			result.paths.append( p.result.paths );
+			if( p.result.error ) {
+				result.errors.push_back( p.file );
+			}
+		}
+
+		return result;
+	}
+
+} // namespace pmm_lookupper
+
+#endif // PMM_LOOKUPPER_ENGINE_HPP_
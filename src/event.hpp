@@ -36,6 +36,13 @@ namespace pmm_lookupper { namespace event {
 		using type = bool (Widget&);
 	};
 
+	// WM_APP and above.
+	struct app
+	{
+		template <class Widget>
+		using type = void (Widget&, UINT, WPARAM, LPARAM);
+	};
+
 	struct destroy
 	{
 		template <class Widget>
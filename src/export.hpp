@@ -0,0 +1,300 @@
+#ifndef PMM_LOOKUPPER_EXPORT_HPP_
+#define PMM_LOOKUPPER_EXPORT_HPP_
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <boost/utility/string_ref.hpp>
+#include <zlib.h>
+#include "filter.hpp"
+#include "mapped_file.hpp"
+#include "path_sources.hpp"
+#include "string_pool.hpp"
+
+namespace pmm_lookupper {
+
+	enum class export_format
+	{
+		text,
+		tsv,
+		ndjson
+	};
+
+	struct export_options
+	{
+		export_format format;
+		bool gzip;
+	};
+
+	// By the extension of file: .tsv, .ndjson or .jsonl, and text for anything
+	// else, gzip-compressed when followed by .gz.
+	inline export_options export_options_of(boost::string_ref file)
+	{
+		export_options opts = { export_format::text, false };
+		auto ext = extension_of( file );
+		if( equal_extension( ext, ".gz" ) ) {
+			opts.gzip = true;
+			ext = extension_of( file.substr( 0, file.size() - ext.size() ) );
+		}
+
+		if( equal_extension( ext, ".tsv" ) ) {
+			opts.format = export_format::tsv;
+		}
+		else if( equal_extension( ext, ".ndjson" ) || equal_extension( ext, ".jsonl" ) ) {
+			opts.format = export_format::ndjson;
+		}
+
+		return opts;
+	}
+
+namespace detail {
+
+	// Writes to a file through one large buffer, deflated to gzip when asked.
+	// Nothing reaches the file before the buffer fills or finish() is called.
+	class export_writer
+	{
+		std::ofstream ofs_;
+		std::vector< char > buf_;
+		std::size_t size_;
+		bool gzip_;
+		bool ok_;
+		z_stream z_;
+		std::vector< char > out_;
+
+	public:
+		export_writer(std::string const& file, bool gzip, std::size_t buffer = 1024 * 1024) :
+			ofs_( native_file_path( file ), std::ios::binary | std::ios::trunc ),
+			buf_( buffer ), size_( 0 ), gzip_( gzip ), ok_( ofs_.is_open() )
+		{
+			if( gzip_ ) {
+				std::memset( &z_, 0, sizeof( z_ ) );
+				// 16 added to the window bits selects the gzip wrapper. Paths compress
+				// well at the fastest level, which keeps an export bound by the disk.
+				gzip_ = deflateInit2( &z_, Z_BEST_SPEED, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY ) == Z_OK;
+				ok_ = ok_ && gzip_;
+				out_.resize( buffer );
+			}
+		}
+
+		export_writer(export_writer const&) = delete;
+		export_writer& operator=(export_writer const&) = delete;
+
+		~export_writer()
+		{
+			if( gzip_ ) {
+				deflateEnd( &z_ );
+			}
+		}
+
+		void put(boost::string_ref s)
+		{
+			while( s.size() > buf_.size() - size_ ) {
+				auto const n = buf_.size() - size_;
+				std::memcpy( buf_.data() + size_, s.data(), n );
+				size_ += n;
+				s.remove_prefix( n );
+				flush( Z_NO_FLUSH );
+			}
+
+			std::memcpy( buf_.data() + size_, s.data(), s.size() );
+			size_ += s.size();
+		}
+
+		inline void put(char c)
+		{
+			if( size_ == buf_.size() ) {
+				flush( Z_NO_FLUSH );
+			}
+			buf_[size_++] = c;
+		}
+
+		// As a JSON string.
+		void put_json(boost::string_ref s)
+		{
+			put( '"' );
+
+			auto begin = s.begin();
+			for( auto p = s.begin(); p != s.end(); ++p ) {
+				auto const c = static_cast< unsigned char >( *p );
+				if( c != '"' && c != '\\' && c >= 0x20 ) {
+					continue;
+				}
+
+				put( boost::string_ref( begin, p - begin ) );
+				if( c == '"' || c == '\\' ) {
+					put( '\\' );
+					put( *p );
+				}
+				else {
+					char esc[8];
+					std::snprintf( esc, sizeof( esc ), "\\u%04x", c );
+					put( boost::string_ref( esc, 6 ) );
+				}
+				begin = p + 1;
+			}
+			put( boost::string_ref( begin, s.end() - begin ) );
+
+			put( '"' );
+		}
+
+		// Writes out what is left. Returns false when any write failed.
+		bool finish()
+		{
+			flush( Z_FINISH );
+			ofs_.close();
+
+			return ok_ && !ofs_.fail();
+		}
+
+	private:
+		void flush(int mode)
+		{
+			if( !ok_ ) {
+				size_ = 0;
+				return;
+			}
+
+			if( !gzip_ ) {
+				ofs_.write( buf_.data(), static_cast< std::streamsize >( size_ ) );
+				size_ = 0;
+				return;
+			}
+
+			z_.next_in = reinterpret_cast< Bytef* >( buf_.data() );
+			z_.avail_in = static_cast< uInt >( size_ );
+			do {
+				z_.next_out = reinterpret_cast< Bytef* >( out_.data() );
+				z_.avail_out = static_cast< uInt >( out_.size() );
+				if( deflate( &z_, mode ) == Z_STREAM_ERROR ) {
+					ok_ = false;
+					break;
+				}
+				ofs_.write( out_.data(), static_cast< std::streamsize >( out_.size() - z_.avail_out ) );
+			} while( z_.avail_out == 0 );
+			size_ = 0;
+		}
+	};
+
+	// Hands out the source of each row: the k-th row of an id gets the file of
+	// its k-th occurrence in the load, and rows of ids never loaded, such as
+	// folders, get none.
+	class row_sources
+	{
+		path_sources const* sources_;
+		std::vector< std::uint32_t > first_;
+		std::vector< std::uint32_t > files_;
+
+	public:
+		// ids is the size of the pool holding every row.
+		row_sources(path_sources const* sources, std::size_t ids) :
+			sources_( sources )
+		{
+			if( !sources_ ) {
+				return;
+			}
+
+			// Files grouped by id, in load order within each group.
+			first_.assign( ids + 1, 0 );
+			for( auto const id : sources_->ids ) {
+				++first_[id + 1];
+			}
+			for( std::size_t i = 0; i < ids; ++i ) {
+				first_[i + 1] += first_[i];
+			}
+
+			files_.resize( sources_->ids.size() );
+			for( std::size_t i = 0; i < sources_->ids.size(); ++i ) {
+				files_[first_[sources_->ids[i]]++] = sources_->file_of[i];
+			}
+
+			// first_[id] now ends the group of id; step back to its start.
+			for( std::size_t i = ids; i > 0; --i ) {
+				first_[i] = first_[i - 1];
+			}
+			first_[0] = 0;
+		}
+
+		// The file of the next row of id, or nullptr.
+		std::string const* next(string_id id)
+		{
+			if( !sources_ || id + 1 >= first_.size() || first_[id] == first_[id + 1] ) {
+				return nullptr;
+			}
+
+			return &sources_->files[files_[first_[id]++]];
+		}
+	};
+
+	// The extension of the file name of path, empty for a folder.
+	inline boost::string_ref export_extension(boost::string_ref path) noexcept
+	{
+		auto const ext = extension_of( path );
+		return ext.find( '\\' ) == ext.npos ? ext : boost::string_ref();
+	}
+
+} // namespace detail
+
+	// Writes rows, ids into strings, to file. Text holds one path per line; TSV
+	// adds the source file and the extension of each path below a header; NDJSON
+	// holds one object per row with the same fields. Sources come from sources
+	// when given, and are left empty (null in NDJSON) otherwise. Text and TSV end
+	// lines with CRLF. Returns false when the file could not be written.
+	inline bool export_rows(
+		std::string const& file, string_pool const& strings, id_list const& rows, path_sources const* sources,
+		export_options const& opts
+	) {
+		detail::export_writer out( file, opts.gzip );
+		detail::row_sources src( opts.format == export_format::text ? nullptr : sources, strings.size() );
+
+		switch( opts.format ) {
+		case export_format::text :
+			for( auto const id : rows ) {
+				out.put( strings[id] );
+				out.put( "\r\n" );
+			}
+			break;
+
+		case export_format::tsv :
+			out.put( "path\tsource\textension\r\n" );
+			for( auto const id : rows ) {
+				auto const path = strings[id];
+				out.put( path );
+				out.put( '\t' );
+				if( auto const s = src.next( id ) ) {
+					out.put( *s );
+				}
+				out.put( '\t' );
+				out.put( detail::export_extension( path ) );
+				out.put( "\r\n" );
+			}
+			break;
+
+		case export_format::ndjson :
+			for( auto const id : rows ) {
+				auto const path = strings[id];
+				out.put( "{\"path\":" );
+				out.put_json( path );
+				out.put( ",\"source\":" );
+				if( auto const s = src.next( id ) ) {
+					out.put_json( *s );
+				}
+				else {
+					out.put( "null" );
+				}
+				out.put( ",\"extension\":" );
+				out.put_json( detail::export_extension( path ) );
+				out.put( "}\n" );
+			}
+			break;
+		}
+
+		return out.finish();
+	}
+
+} // namespace pmm_lookupper
+
+#endif // PMM_LOOKUPPER_EXPORT_HPP_
@@ -0,0 +1,193 @@
+#ifndef PMM_LOOKUPPER_FILESYSTEM_HPP_
+#define PMM_LOOKUPPER_FILESYSTEM_HPP_
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <boost/utility/string_ref.hpp>
+
+#ifdef _WIN32
+#	include "winapi.hpp"
+#else
+#	include <dirent.h>
+#	include <limits.h>
+#	include <sys/stat.h>
+#endif
+
+namespace pmm_lookupper {
+
+	struct directory_entry
+	{
+		std::string name;
+		bool is_directory;
+	};
+
+	// mtime is in the platform's own units and is only compared for equality.
+	struct file_status
+	{
+		bool exists;
+		bool is_directory;
+		std::uint64_t size;
+		std::int64_t mtime;
+	};
+
+	inline file_status get_file_status(boost::string_ref path)
+	{
+		file_status result = { false, false, 0, 0 };
+#ifdef _WIN32
+		WIN32_FILE_ATTRIBUTE_DATA data;
+		if( !GetFileAttributesExW( multibyte_to_wide( path, CP_UTF8 ).c_str(), GetFileExInfoStandard, &data ) ) {
+			return result;
+		}
+
+		result.exists = true;
+		result.is_directory = ( data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY ) != 0;
+		result.size = ( static_cast< std::uint64_t >( data.nFileSizeHigh ) << 32 ) | data.nFileSizeLow;
+		result.mtime = static_cast< std::int64_t >(
+			( static_cast< std::uint64_t >( data.ftLastWriteTime.dwHighDateTime ) << 32 ) | data.ftLastWriteTime.dwLowDateTime
+		);
+#else
+		struct stat st;
+		if( ::stat( path.to_string().c_str(), &st ) != 0 ) {
+			return result;
+		}
+
+		result.exists = true;
+		result.is_directory = S_ISDIR( st.st_mode );
+		result.size = static_cast< std::uint64_t >( st.st_size );
+		result.mtime = static_cast< std::int64_t >( st.st_mtim.tv_sec ) * 1000000000 + st.st_mtim.tv_nsec;
+#endif
+
+		return result;
+	}
+
+	// Absolute form of path, used to identify a file. Falls back to path itself.
+	inline std::string canonical_path(boost::string_ref path)
+	{
+#ifdef _WIN32
+		auto const src = multibyte_to_wide( path, CP_UTF8 );
+		std::wstring buf( MAX_PATH, L'\0' );
+		auto n = GetFullPathNameW( src.c_str(), static_cast< DWORD >( buf.size() ), &buf[0], nullptr );
+		if( n > buf.size() ) {
+			buf.resize( n );
+			n = GetFullPathNameW( src.c_str(), static_cast< DWORD >( buf.size() ), &buf[0], nullptr );
+		}
+		if( n == 0 || n > buf.size() ) {
+			return path.to_string();
+		}
+		buf.resize( n );
+
+		return wide_to_multibyte( buf, CP_UTF8 );
+#else
+		char buf[PATH_MAX];
+		if( !::realpath( path.to_string().c_str(), buf ) ) {
+			return path.to_string();
+		}
+
+		return buf;
+#endif
+	}
+
+	// Replaces to with from in one step, so readers of to see either file whole.
+	inline bool replace_file(boost::string_ref from, boost::string_ref to)
+	{
+#ifdef _WIN32
+		return MoveFileExW(
+			multibyte_to_wide( from, CP_UTF8 ).c_str(), multibyte_to_wide( to, CP_UTF8 ).c_str(),
+			MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH
+		) != FALSE;
+#else
+		return std::rename( from.to_string().c_str(), to.to_string().c_str() ) == 0;
+#endif
+	}
+
+	inline bool remove_file(boost::string_ref path)
+	{
+#ifdef _WIN32
+		return DeleteFileW( multibyte_to_wide( path, CP_UTF8 ).c_str() ) != FALSE;
+#else
+		return std::remove( path.to_string().c_str() ) == 0;
+#endif
+	}
+
+	inline bool is_directory(boost::string_ref path)
+	{
+#ifdef _WIN32
+		return PathIsDirectoryW( multibyte_to_wide( path, CP_UTF8 ).c_str() ) != FALSE;
+#else
+		struct stat st;
+		return ::stat( path.to_string().c_str(), &st ) == 0 && S_ISDIR( st.st_mode );
+#endif
+	}
+
+	inline std::string join_path(boost::string_ref dir, boost::string_ref name)
+	{
+#ifdef _WIN32
+		char const sep = '\\';
+#else
+		char const sep = '/';
+#endif
+		std::string result( dir.begin(), dir.end() );
+		if( !result.empty() && result.back() != sep && result.back() != '/' ) {
+			result += sep;
+		}
+		result.append( name.begin(), name.end() );
+
+		return result;
+	}
+
+	// Entries of a directory other than "." and "..". Symbolic links and junctions
+	// to directories are reported as files so that a crawl cannot loop. Returns
+	// false when the directory cannot be read.
+	inline bool list_directory(boost::string_ref path, std::vector< directory_entry >& entries)
+	{
+#ifdef _WIN32
+		WIN32_FIND_DATAW data;
+		HANDLE const h = FindFirstFileW( multibyte_to_wide( join_path( path, "*" ), CP_UTF8 ).c_str(), &data );
+		if( h == INVALID_HANDLE_VALUE ) {
+			return false;
+		}
+
+		do {
+			std::wstring const name( data.cFileName );
+			if( name == L"." || name == L".." ) {
+				continue;
+			}
+
+			bool const dir = ( data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY )
+				&& !( data.dwFileAttributes & FILE_ATTRIBUTE_REPARSE_POINT );
+			entries.push_back( { wide_to_multibyte( name, CP_UTF8 ), dir } );
+		} while( FindNextFileW( h, &data ) );
+
+		FindClose( h );
+#else
+		DIR* const d = ::opendir( path.to_string().c_str() );
+		if( !d ) {
+			return false;
+		}
+
+		while( auto const e = ::readdir( d ) ) {
+			std::string name( e->d_name );
+			if( name == "." || name == ".." ) {
+				continue;
+			}
+
+			bool dir = e->d_type == DT_DIR;
+			if( e->d_type == DT_UNKNOWN ) {
+				struct stat st;
+				dir = ::lstat( join_path( path, name ).c_str(), &st ) == 0 && S_ISDIR( st.st_mode );
+			}
+			entries.push_back( { std::move( name ), dir } );
+		}
+
+		::closedir( d );
+#endif
+
+		return true;
+	}
+
+} // namespace pmm_lookupper
+
+#endif // PMM_LOOKUPPER_FILESYSTEM_HPP_
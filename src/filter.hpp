@@ -1,9 +1,11 @@
 #ifndef PMM_LOOKUPPER_FILTER_HPP_
 #define PMM_LOOKUPPER_FILTER_HPP_
 
+#include <algorithm>
 #include <vector>
 #include <string>
-#include "pmm.hpp"
+#include <boost/utility/string_ref.hpp>
+#include "filesystem.hpp"
 
 namespace pmm_lookupper { 
 
@@ -12,7 +14,7 @@ namespace pmm_lookupper {
 		std::vector< std::string > result;
 
 		for( auto const& str : paths ) {
-			if( PathIsDirectoryW( multibyte_to_wide( str, CP_UTF8 ).c_str() ) ) {
+			if( is_directory( str ) ) {
 				result.emplace_back( str );
 			}
 			else {
@@ -24,22 +26,66 @@ namespace pmm_lookupper {
 		return result;
 	}
 
+	inline boost::string_ref extension_of(boost::string_ref path) noexcept
+	{
+		auto p = path.find_last_of( '.' );
+		if( p == path.npos ) {
+			return {};
+		}
+
+		return path.substr( p );
+	}
+
+	// Extensions are compared ASCII case-insensitively; ".PMX" -> ".pmx".
+	inline std::string fold_extension(boost::string_ref ext)
+	{
+		std::string result( ext.begin(), ext.end() );
+		for( auto& c : result ) {
+			if( c >= 'A' && c <= 'Z' ) {
+				c = static_cast< char >( c - 'A' + 'a' );
+			}
+		}
+
+		return result;
+	}
+
+	inline bool equal_extension(boost::string_ref lhs, boost::string_ref rhs) noexcept
+	{
+		auto const fold = [](char c) {
+			return c >= 'A' && c <= 'Z' ? static_cast< char >( c - 'A' + 'a' ) : c;
+		};
+
+		return lhs.size() == rhs.size() && std::equal( lhs.begin(), lhs.end(), rhs.begin(), [&](char a, char b) {
+			return fold( a ) == fold( b );
+		} );
+	}
+
+	// True when the extension of path is exactly one of exts, e.g. ".fx" matches
+	// "a.FX" but not "a.fxsub".
+	inline bool has_extension(boost::string_ref path, std::vector< std::string > const& exts) noexcept
+	{
+		auto const tail = extension_of( path );
+		if( tail.empty() ) {
+			return false;
+		}
+
+		for( auto const& ext : exts ) {
+			if( equal_extension( tail, ext ) ) {
+				return true;
+			}
+		}
+
+		return false;
+	}
+
 	inline std::vector< std::string > match_extension(
 		std::vector< std::string > const& paths, std::vector< std::string > const& exts
 	) {
 		std::vector< std::string > result;
 
 		for( auto const& path : paths ) {
-			auto p = path.find_last_of( '.' );
-			if( p == path.npos ) {
-				continue;
-			}
-
-			for( auto const& ext : exts ) {
-				if( path.find( ext, p ) != path.npos ) {
-					result.emplace_back( path );
-					break;
-				}
+			if( has_extension( path, exts ) ) {
+				result.emplace_back( path );
 			}
 		}
 
@@ -0,0 +1,378 @@
+#ifndef PMM_LOOKUPPER_FILTER_ENGINE_HPP_
+#define PMM_LOOKUPPER_FILTER_ENGINE_HPP_
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include <boost/optional.hpp>
+#include <boost/range/algorithm.hpp>
+#include <boost/utility/string_ref.hpp>
+#include "filter.hpp"
+#include "path_list.hpp"
+#include "path_identity.hpp"
+#include "pipeline_stats.hpp"
+#include "query.hpp"
+#include "sort_keys.hpp"
+#include "stat_cache.hpp"
+#include "string_pool.hpp"
+
+namespace pmm_lookupper {
+
+	struct extension_count
+	{
+		std::string extension;
+		std::size_t paths;
+		std::size_t occurrences;
+	};
+
+	// Answers run_query over a fixed id list while the options change. Paths are
+	// grouped once into buckets by their text from the last '.', each sorted and
+	// deduplicated, and the buckets are indexed by folded extension. A filter edit
+	// looks up each extension and merges in or drops whole buckets; the previous
+	// sorted result is reused as long as the other options stay the same. Paths
+	// naming the same file differ at most in case, so they share an index entry.
+	class filter_engine
+	{
+		struct bucket
+		{
+			boost::string_ref tail;
+			id_list ids;
+		};
+
+		// Buckets differing only in case share an entry.
+		struct index_entry
+		{
+			std::vector< std::uint32_t > buckets;
+			std::size_t paths;
+			std::size_t occurrences;
+		};
+
+		struct state
+		{
+			bool duplication;
+			sort_order order;
+		};
+
+		std::shared_ptr< string_pool const > strings_;
+		sort_keys keys_;
+		path_aliases aliases_;
+		id_list data_;
+		id_list unique_;
+		std::vector< std::uint32_t > counts_;
+		std::vector< std::uint32_t > bucket_of_;
+		id_list parents_;
+		std::vector< bucket > buckets_;
+		std::unordered_map< std::string, index_entry > index_;
+
+		boost::optional< state > state_;
+		std::vector< char > selected_;
+		id_list result_;
+		stat_cache* stats_;
+		boost::optional< id_list > folders_[2];
+		stat_cache::clock::time_point folders_time_[2];
+
+	public:
+		filter_engine(std::shared_ptr< string_pool > strings, id_list const& data, stat_cache* stats = nullptr) :
+			filter_engine( strings, data, intern_folders( data, *strings ), stats )
+		{ }
+
+		// parents are intern_folders( data, *strings ). strings is only read, so it
+		// may already be shared with other threads.
+		filter_engine(std::shared_ptr< string_pool const > strings, id_list const& data, id_list parents, stat_cache* stats = nullptr) :
+			strings_( std::move( strings ) ),
+			keys_( *strings_ ),
+			aliases_( data, *strings_ ),
+			data_( data ),
+			counts_( strings_->size(), 0 ),
+			bucket_of_( strings_->size(), static_cast< std::uint32_t >( -1 ) ),
+			parents_( std::move( parents ) ),
+			stats_( stats )
+		{
+			auto const& pool = *strings_;
+
+			for( auto const id : data ) {
+				if( counts_[id]++ == 0 ) {
+					unique_.push_back( id );
+				}
+			}
+
+			std::unordered_map< boost::string_ref, std::uint32_t, string_ref_hash > index;
+			for( auto const id : unique_ ) {
+				auto const tail = extension_of( pool[id] );
+				if( tail.empty() ) {
+					continue;
+				}
+
+				auto const itr = index.emplace( tail, static_cast< std::uint32_t >( buckets_.size() ) ).first;
+				if( itr->second == buckets_.size() ) {
+					buckets_.push_back( { tail, {} } );
+				}
+				buckets_[itr->second].ids.push_back( id );
+			}
+
+			// Buckets in the order the extension sort puts them.
+			boost::sort( buckets_, [](bucket const& lhs, bucket const& rhs) {
+				return boost::lexicographical_compare( lhs.tail, rhs.tail );
+			} );
+
+			for( std::uint32_t i = 0; i < buckets_.size(); ++i ) {
+				keys_.sort_by_path( buckets_[i].ids );
+				auto& entry = index_[fold_extension( buckets_[i].tail )];
+				entry.buckets.push_back( i );
+				for( auto const id : buckets_[i].ids ) {
+					bucket_of_[id] = i;
+					entry.paths += aliases_.is_first( id ) ? 1 : 0;
+					entry.occurrences += counts_[id];
+				}
+			}
+
+			selected_.assign( buckets_.size(), 0 );
+		}
+
+		filter_engine(filter_engine const&) = delete;
+		filter_engine& operator=(filter_engine const&) = delete;
+
+		inline std::shared_ptr< string_pool const > const& strings() const noexcept
+		{
+			return strings_;
+		}
+
+		// Number of distinct files, or of all occurrences, with the extension ext.
+		std::size_t count(boost::string_ref ext, bool duplication) const
+		{
+			auto const itr = index_.find( fold_extension( ext ) );
+			if( itr == index_.end() ) {
+				return 0;
+			}
+
+			return duplication ? itr->second.occurrences : itr->second.paths;
+		}
+
+		// Counts of every extension present, by folded extension.
+		std::vector< extension_count > extension_counts() const
+		{
+			std::vector< extension_count > result;
+			for( auto const& kv : index_ ) {
+				result.push_back( { kv.first, kv.second.paths, kv.second.occurrences } );
+			}
+			boost::sort( result, [](extension_count const& lhs, extension_count const& rhs) {
+				return lhs.extension < rhs.extension;
+			} );
+
+			return result;
+		}
+
+		// Same ids as run_query( data, strings, keys, aliases, opts, stats ). cancel
+		// is polled between buckets; a cancelled query returns an empty list and
+		// the next one starts over.
+		id_list const& query(query_options const& opts, cancel_token const* cancel = nullptr)
+		{
+			if( opts.folder_only ) {
+				return folders( opts.duplication, cancel );
+			}
+
+			stage_timer timer( stat_stage::filter );
+			auto const sel = select( opts.extensions );
+
+			if( opts.order == sort_order::input ) {
+				in_input_order( sel, opts.duplication );
+			}
+			else if( opts.order == sort_order::extension ) {
+				result_.clear();
+				for( std::size_t i = 0; i < buckets_.size() && !is_cancelled( cancel ); ++i ) {
+					if( sel[i] ) {
+						append( result_, i, opts.duplication );
+					}
+				}
+			}
+			else if( !state_ || state_->duplication != opts.duplication || state_->order != opts.order ) {
+				result_.clear();
+				for( std::size_t i = 0; i < buckets_.size() && !is_cancelled( cancel ); ++i ) {
+					if( sel[i] ) {
+						merge( i, opts.duplication );
+					}
+				}
+			}
+			else {
+				bool removed = false;
+				for( std::size_t i = 0; i < buckets_.size(); ++i ) {
+					removed = removed || ( selected_[i] && !sel[i] );
+				}
+				if( removed ) {
+					result_.erase( std::remove_if( result_.begin(), result_.end(), [&](string_id id) {
+						return !sel[bucket_of_[id]];
+					} ), result_.end() );
+				}
+
+				for( std::size_t i = 0; i < buckets_.size() && !is_cancelled( cancel ); ++i ) {
+					if( sel[i] && !selected_[i] ) {
+						merge( i, opts.duplication );
+					}
+				}
+			}
+
+			if( is_cancelled( cancel ) ) {
+				return cancelled();
+			}
+
+			state_ = state{ opts.duplication, opts.order };
+			selected_ = sel;
+
+			if( timer.active() ) {
+				count_removed( sel );
+			}
+
+			return result_;
+		}
+
+	private:
+		struct path_less
+		{
+			string_pool const* pool;
+
+			inline bool operator()(string_id lhs, string_id rhs) const noexcept
+			{
+				return ( *pool )[lhs] < ( *pool )[rhs];
+			}
+		};
+
+		inline path_less by_path() const noexcept
+		{
+			return path_less{ strings_.get() };
+		}
+
+		// result_ may be half built.
+		id_list const& cancelled()
+		{
+			state_ = boost::none;
+			result_.clear();
+
+			return result_;
+		}
+
+		std::vector< char > select(std::vector< std::string > const& exts) const
+		{
+			std::vector< char > sel( buckets_.size(), 0 );
+
+			for( auto const& ext : exts ) {
+				auto const itr = index_.find( fold_extension( ext ) );
+				if( itr == index_.end() ) {
+					continue;
+				}
+
+				for( auto const i : itr->second.buckets ) {
+					sel[i] = 1;
+				}
+			}
+
+			return sel;
+		}
+
+		// The counts run_query would add for the current result.
+		void count_removed(std::vector< char > const& sel) const
+		{
+			std::size_t occurrences = 0;
+			for( std::size_t i = 0; i < buckets_.size(); ++i ) {
+				if( !sel[i] ) {
+					continue;
+				}
+				for( auto const id : buckets_[i].ids ) {
+					occurrences += counts_[id];
+				}
+			}
+
+			count_stat( stat_counter::filtered_out, data_.size() - occurrences );
+			count_stat( stat_counter::duplicates_removed, occurrences - result_.size() );
+		}
+
+		inline bool selected(std::vector< char > const& sel, string_id id) const noexcept
+		{
+			auto const b = bucket_of_[id];
+			return b < sel.size() && sel[b];
+		}
+
+		void append(id_list& out, std::size_t i, bool duplication) const
+		{
+			for( auto const id : buckets_[i].ids ) {
+				if( duplication ) {
+					out.insert( out.end(), counts_[id], id );
+				}
+				else if( aliases_.is_first( id ) ) {
+					out.push_back( id );
+				}
+			}
+		}
+
+		void in_input_order(std::vector< char > const& sel, bool duplication)
+		{
+			result_.clear();
+			for( auto const id : duplication ? data_ : unique_ ) {
+				if( selected( sel, id ) && ( duplication || aliases_.is_first( id ) ) ) {
+					result_.push_back( id );
+				}
+			}
+		}
+
+		// Paths of different buckets are never equal, so merging keeps equal ids
+		// adjacent.
+		void merge(std::size_t i, bool duplication)
+		{
+			id_list added;
+			append( added, i, duplication );
+
+			id_list merged;
+			merged.reserve( result_.size() + added.size() );
+			std::merge( result_.begin(), result_.end(), added.begin(), added.end(), std::back_inserter( merged ), [this](string_id lhs, string_id rhs) {
+				return keys_.path_rank( lhs ) < keys_.path_rank( rhs );
+			} );
+			result_.swap( merged );
+		}
+
+		id_list const& folders(bool duplication, cancel_token const* cancel)
+		{
+			// Folder lists follow the expiry of the stat cache.
+			auto& cached = folders_[duplication ? 1 : 0];
+			auto& time = folders_time_[duplication ? 1 : 0];
+			auto const now = stat_cache::clock::now();
+			if( cached && stats_ && stats_->max_age() != stat_cache::clock::duration::zero() && now - time >= stats_->max_age() ) {
+				cached = boost::none;
+			}
+
+			if( !cached ) {
+				id_list ids;
+				for( auto const id : unique_ ) {
+					if( duplication ) {
+						ids.insert( ids.end(), counts_[id], id );
+					}
+					else if( aliases_.is_first( id ) ) {
+						ids.push_back( id );
+					}
+				}
+
+				stage_timer timer( stat_stage::folders );
+				ids = folders_of( ids, *strings_, parents_, !duplication, stats_, cancel );
+				timer.stop();
+				if( is_cancelled( cancel ) ) {
+					return cancelled();
+				}
+				boost::sort( ids, by_path() );
+				cached = std::move( ids );
+				time = now;
+			}
+
+			// As run_query counts them: nothing is filtered out of folder lists.
+			count_stat( stat_counter::duplicates_removed, data_.size() - cached->size() );
+
+			return *cached;
+		}
+	};
+
+} // namespace pmm_lookupper
+
+#endif // PMM_LOOKUPPER_FILTER_ENGINE_HPP_
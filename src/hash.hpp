@@ -0,0 +1,150 @@
+#ifndef PMM_LOOKUPPER_HASH_HPP_
+#define PMM_LOOKUPPER_HASH_HPP_
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <boost/utility/string_ref.hpp>
+
+namespace pmm_lookupper {
+
+	// Streaming XXH64.
+	class content_hash
+	{
+		static std::uint64_t const p1 = 0x9e3779b185ebca87ull;
+		static std::uint64_t const p2 = 0xc2b2ae3d27d4eb4full;
+		static std::uint64_t const p3 = 0x165667b19e3779f9ull;
+		static std::uint64_t const p4 = 0x85ebca77c2b2ae63ull;
+		static std::uint64_t const p5 = 0x27d4eb2f165667c5ull;
+
+		std::uint64_t v_[4];
+		std::uint64_t seed_;
+		std::uint64_t total_;
+		unsigned char buf_[32];
+		std::size_t buf_size_;
+
+	public:
+		explicit content_hash(std::uint64_t seed = 0) noexcept :
+			seed_( seed ), total_( 0 ), buf_size_( 0 )
+		{
+			v_[0] = seed + p1 + p2;
+			v_[1] = seed + p2;
+			v_[2] = seed;
+			v_[3] = seed - p1;
+		}
+
+		void update(boost::string_ref data) noexcept
+		{
+			auto p = reinterpret_cast< unsigned char const* >( data.data() );
+			auto n = data.size();
+			total_ += n;
+
+			if( buf_size_ ) {
+				auto const k = std::min( n, sizeof( buf_ ) - buf_size_ );
+				std::memcpy( buf_ + buf_size_, p, k );
+				buf_size_ += k;
+				p += k;
+				n -= k;
+				if( buf_size_ < sizeof( buf_ ) ) {
+					return;
+				}
+				stripe( buf_ );
+				buf_size_ = 0;
+			}
+
+			for( ; n >= 32; p += 32, n -= 32 ) {
+				stripe( p );
+			}
+
+			std::memcpy( buf_, p, n );
+			buf_size_ = n;
+		}
+
+		std::uint64_t digest() const noexcept
+		{
+			std::uint64_t h;
+			if( total_ >= 32 ) {
+				h = rotl( v_[0], 1 ) + rotl( v_[1], 7 ) + rotl( v_[2], 12 ) + rotl( v_[3], 18 );
+				for( auto const v : v_ ) {
+					h ^= round( 0, v );
+					h = h * p1 + p4;
+				}
+			}
+			else {
+				h = seed_ + p5;
+			}
+			h += total_;
+
+			auto p = buf_;
+			auto n = buf_size_;
+			for( ; n >= 8; p += 8, n -= 8 ) {
+				h ^= round( 0, read64( p ) );
+				h = rotl( h, 27 ) * p1 + p4;
+			}
+			if( n >= 4 ) {
+				h ^= static_cast< std::uint64_t >( read32( p ) ) * p1;
+				h = rotl( h, 23 ) * p2 + p3;
+				p += 4;
+				n -= 4;
+			}
+			for( ; n > 0; ++p, --n ) {
+				h ^= *p * p5;
+				h = rotl( h, 11 ) * p1;
+			}
+
+			h ^= h >> 33;
+			h *= p2;
+			h ^= h >> 29;
+			h *= p3;
+			h ^= h >> 32;
+
+			return h;
+		}
+
+	private:
+		static std::uint64_t rotl(std::uint64_t x, int r) noexcept
+		{
+			return ( x << r ) | ( x >> ( 64 - r ) );
+		}
+
+		static std::uint64_t round(std::uint64_t acc, std::uint64_t input) noexcept
+		{
+			acc += input * p2;
+			return rotl( acc, 31 ) * p1;
+		}
+
+		static std::uint64_t read64(unsigned char const* p) noexcept
+		{
+			std::uint64_t v = 0;
+			for( int i = 7; i >= 0; --i ) {
+				v = ( v << 8 ) | p[i];
+			}
+			return v;
+		}
+
+		static std::uint32_t read32(unsigned char const* p) noexcept
+		{
+			return static_cast< std::uint32_t >( p[0] ) | ( static_cast< std::uint32_t >( p[1] ) << 8 )
+				| ( static_cast< std::uint32_t >( p[2] ) << 16 ) | ( static_cast< std::uint32_t >( p[3] ) << 24 );
+		}
+
+		void stripe(unsigned char const* p) noexcept
+		{
+			for( int i = 0; i < 4; ++i ) {
+				v_[i] = round( v_[i], read64( p + i * 8 ) );
+			}
+		}
+	};
+
+	inline std::uint64_t hash_content(boost::string_ref data) noexcept
+	{
+		content_hash h;
+		h.update( data );
+
+		return h.digest();
+	}
+
+} // namespace pmm_lookupper
+
+#endif // PMM_LOOKUPPER_HASH_HPP_
@@ -4,13 +4,15 @@
 #include "winapi.hpp"
 #include "event_handler.hpp"
 #include "procedure.hpp"
-#include "pmm.hpp"
+#include "engine.hpp"
+#include "export.hpp"
+#include "query_engine.hpp"
 #include "result_view.hpp"
 #include "filter.hpp"
-#include "emm.hpp"
+#include "query.hpp"
+#include "options.hpp"
 #include "controls.hpp"
 #include <array>
-#include <boost/spirit/include/qi.hpp>
 
 namespace pmm_lookupper {
 	
@@ -19,15 +21,28 @@ namespace pmm_lookupper {
 	public:
 		using event_handler_type = event_handler< 
 			main_window, 
-			event::drop_files, event::command, event::notify, event::sizing, event::close, event::destroy 
+			event::drop_files, event::command, event::notify, event::sizing, event::close, event::app, event::destroy 
 		>;
 
+		// Posted by the query engine with a heap-allocated payload in lparam.
+		enum : UINT
+		{
+			wm_query_progress = WM_APP,
+			wm_query_loaded,
+			wm_query_result
+		};
+
 	private:
 		HWND dlg_;
 		HMENU popup_;
 		boost::shared_ptr< result_view< main_window > > result_;
 		event_handler_type eh_;
-		std::vector< std::string > data_;
+		thread_pool pool_;
+		stat_cache stats_;
+		std::unique_ptr< scan_cache > cache_;
+		std::uint64_t generation_;
+		std::uint64_t load_generation_;
+		query_engine engine_;
 		RECT rv_offset_;
 		std::array< POINT, controls::size > opt_offsets_;
 
@@ -37,7 +52,12 @@ namespace pmm_lookupper {
 				MAKEINTRESOURCEW( IDD_MAINWINDOW ), nullptr, 
 				dialog_procedure< main_window >::address() 
 			) ),
-			result_( result_view< main_window >::make( dlg_, IDC_RESULT ) )
+			result_( result_view< main_window >::make( dlg_, IDC_RESULT ) ),
+			stats_( pool_, std::chrono::minutes( 5 ) ),
+			cache_( open_scan_cache() ),
+			generation_( 0 ),
+			load_generation_( 0 ),
+			engine_( pool_, make_listener( dlg_ ), &stats_, cache_.get() )
 		{ 
 			if( !dlg_ || !result_ ) {
 				throw std::runtime_error( "ウィンドウを生成できませんでした" );
@@ -50,13 +70,15 @@ namespace pmm_lookupper {
 			eh_.set( event::drop_files(), &on_dragfiles );
 			eh_.set( event::notify(), &on_notify );
 			eh_.set( event::sizing(), &on_sizing );
+			eh_.set( event::app(), &on_app );
 			eh_.set( event::destroy(), &on_destroy );
 
 			popup_ = LoadMenuW( nullptr, MAKEINTRESOURCEW( IDR_POPUPMENU ) );
 
-			set_window_text( GetDlgItem( dlg_, IDC_EXTFILTER ), "pmx pmd x wav bmp fx fxsub" );
+			set_window_text( GetDlgItem( dlg_, IDC_EXTFILTER ), default_extensions );
 			cb_add_string( GetDlgItem( dlg_, IDC_SORT_COND ), "ファイルパス" );
 			cb_add_string( GetDlgItem( dlg_, IDC_SORT_COND ), "拡張子" );
+			cb_add_string( GetDlgItem( dlg_, IDC_SORT_COND ), "読み込み順" );
 			cb_set_cursel( GetDlgItem( dlg_, IDC_SORT_COND ), 0 );
 
 			rv_offset_ = result_view_offset();
@@ -81,21 +103,7 @@ namespace pmm_lookupper {
 
 		inline std::vector< std::string > get_extensions_filter() const
 		{
-			namespace qi = boost::spirit::qi;
-			
-			std::vector< std::string > exts;
-
-			auto const tmp_exts = get_window_text( GetDlgItem( handle(), IDC_EXTFILTER ) );
-			auto const parser = boost::proto::deep_copy(
-				qi::as< std::vector< std::string > >()[ +qi::alnum % qi::omit[+qi::lit( ' ' )] ]
-			);
-			qi::parse( tmp_exts.begin(), tmp_exts.end(), parser, exts );
-
-			for( auto& ext : exts ) {
-				ext = std::string( "." ) + ext;
-			}
-
-			return exts;
+			return parse_extensions( get_window_text( GetDlgItem( handle(), IDC_EXTFILTER ) ) );
 		}
 
 		inline explicit operator bool() const noexcept
@@ -105,104 +113,96 @@ namespace pmm_lookupper {
 
 		void update()
 		{
-			auto buf = data_;
-
-			if( IsDlgButtonChecked( handle(), IDC_FOLDER_ONLY ) ) {
-				EnableWindow( GetDlgItem( dlg_, IDC_SORT_COND ), FALSE );
-				buf = remove_file_path( buf );
-			}
-			else {
-				EnableWindow( GetDlgItem( dlg_, IDC_SORT_COND ), TRUE );
-				buf = match_extension( buf, get_extensions_filter() );
-			}
+			bool const folder_only = IsDlgButtonChecked( handle(), IDC_FOLDER_ONLY );
+			EnableWindow( GetDlgItem( dlg_, IDC_SORT_COND ), folder_only ? FALSE : TRUE );
 
-			auto const sort_cond_index = cb_get_cursel( GetDlgItem( dlg_, IDC_SORT_COND ) );
-			if( IsWindowEnabled( GetDlgItem( dlg_, IDC_SORT_COND ) ) && sort_cond_index == 1 ) {
-				boost::sort( buf );
-				boost::stable_sort( buf, [](std::string const& lhs, std::string const& rhs) -> bool {
-					return boost::lexicographical_compare( get_extension( lhs ), get_extension( rhs ) );
-				} );
-			}
-			else {
-				boost::sort( buf );
-			}
+			query_options opts;
+			opts.extensions = get_extensions_filter();
+			opts.folder_only = folder_only;
+			opts.duplication = IsDlgButtonChecked( handle(), IDC_DUPLICATION );
+			opts.order = sort_order_of( cb_get_cursel( GetDlgItem( dlg_, IDC_SORT_COND ) ) );
 
-			if( !IsDlgButtonChecked( handle(), IDC_DUPLICATION ) ) {
-				buf.erase( std::unique( buf.begin(), buf.end() ), buf.end() );
-			}
+			// A query still running for the previous options is cancelled.
+			generation_ = engine_.query( opts );
+		}
 
-			auto rv = get_result_view();
-			rv->update( buf );
+		// Loads in the background; the view keeps the previous rows until the
+		// first rows of the new ones arrive.
+		void refresh(std::vector< std::string > const& files)
+		{
+			load_generation_ = engine_.load( files );
+			update();
 		}
 
-		template <class F>
-		static void append_data(
-			std::string const& file, F f, std::vector< std::string >& data 
-		) {
-			auto const paths = f( file );
-			if( !paths.empty() ) {
-				for( auto const& p : paths ) {
-					data.push_back( p );
-				}
+		// The entries of IDC_SORT_COND, in order.
+		static sort_order sort_order_of(int index) noexcept
+		{
+			switch( index ) {
+			case 1 :
+				return sort_order::extension;
+			case 2 :
+				return sort_order::input;
+			default :
+				return sort_order::path;
 			}
 		}
 
-		template <class F>
-		static void append_data(
-			std::string const& file, F f, std::vector< std::string >& data, std::vector< std::string >& errors
-		) {
-			auto const paths = f( file );
-			if( paths.empty() ) {
-				errors.push_back( file );
-			}
-			else {
-				for( auto const& p : paths ) {
-					data.push_back( p );
-				}
+		static int sort_order_index(sort_order order) noexcept
+		{
+			switch( order ) {
+			case sort_order::extension :
+				return 1;
+			case sort_order::input :
+				return 2;
+			default :
+				return 0;
 			}
 		}
 
-		void refresh(std::vector< std::string > const& files)
+	private:
+		// The payload is freed by on_app, or here when the window is gone.
+		template <class T>
+		static void post_payload(HWND dlg, UINT msg, T payload)
 		{
-			std::vector< std::string > errors;
+			auto const p = new T( std::move( payload ) );
+			if( !PostMessageW( dlg, msg, 0, reinterpret_cast< LPARAM >( p ) ) ) {
+				delete p;
+			}
+		}
 
-			data_.clear();
+		static query_listener make_listener(HWND dlg)
+		{
+			query_listener listener;
+			listener.progress = [dlg](query_progress const& p) {
+				post_payload( dlg, wm_query_progress, p );
+			};
+			listener.loaded = [dlg](load_report r) {
+				post_payload( dlg, wm_query_loaded, std::move( r ) );
+			};
+			listener.result = [dlg](query_result r) {
+				post_payload( dlg, wm_query_result, std::move( r ) );
+			};
 
-			for( auto const& f : files ) {
-				auto const ext = get_extension( f );
+			return listener;
+		}
 
-				if( ext == ".pmm" ) {
-					append_data( f, &pmm_contain_file_paths, data_, errors );
-					auto const emm_path = f.substr( 0, f.find_last_of( '.' ) ) + ".emm";
-					append_data( emm_path, &emm_contain_file_paths, data_ );
-				}
-				else if( ext == ".emm" ) {
-					if( is_emm_file( f ) ) {
-						append_data( f, &emm_contain_file_paths, data_ );
-					}
-					else {
-						errors.push_back( f );
-					}
-				}
-				else {
-					errors.push_back( f );
-				}
+		// The cache lives in %LOCALAPPDATA%\pmm_lookupper and is skipped when that
+		// cannot be used.
+		static std::unique_ptr< scan_cache > open_scan_cache()
+		{
+			auto const base = get_environment_variable( "LOCALAPPDATA" );
+			if( !base ) {
+				return nullptr;
 			}
 
-			if( !errors.empty() ) {
-				std::string str( "読み込めないファイルがありました。\r\n" );
-
-				for( auto const& s : errors ) {
-					str += s + "\r\n";
-				}
-
-				message_box( "エラー", str, MB_OK | MB_ICONWARNING );
+			auto const dir = join_path( *base, "pmm_lookupper" );
+			if( !CreateDirectoryW( multibyte_to_wide( dir, CP_UTF8 ).c_str(), nullptr ) && GetLastError() != ERROR_ALREADY_EXISTS ) {
+				return nullptr;
 			}
 
-			update();
+			return std::unique_ptr< scan_cache >( new scan_cache( join_path( dir, "scan_cache.bin" ) ) );
 		}
 
-	private:
 		inline RECT result_view_offset() const noexcept
 		{
 			RECT rc;
@@ -290,15 +290,18 @@ namespace pmm_lookupper {
 
 		static void on_idc_save(main_window& wnd)
 		{
+			// The format follows the extension of the chosen name.
 			auto const result = get_save_file_name(
-				wnd.handle(), "テキストファイル (*.txt)\n*.txt\nすべてのファイル (*.*)\n*.*\n\n", "txt",
+				wnd.handle(),
+				"テキストファイル (*.txt)\n*.txt\nTSV (*.tsv)\n*.tsv\nNDJSON (*.ndjson)\n*.ndjson\n"
+				"gzip圧縮 (*.txt.gz;*.tsv.gz;*.ndjson.gz)\n*.txt.gz;*.tsv.gz;*.ndjson.gz\nすべてのファイル (*.*)\n*.*\n\n", "txt",
 				OFN_EXPLORER | OFN_OVERWRITEPROMPT
 			);
 			if( result.which() == 0 ) {
-				std::ofstream ofs( convert_code( boost::get< std::string >( result ), CP_UTF8, CP_OEMCP ) );
-				for( auto const& str : wnd.get_result_view()->data() ) {
-					auto const s = convert_code( str, CP_UTF8, CP_OEMCP );
-					ofs << s << std::endl;
+				auto const& file = boost::get< std::string >( result );
+				auto const& model = wnd.get_result_view()->model();
+				if( !export_rows( file, model.strings(), model.rows(), model.sources(), export_options_of( file ) ) ) {
+					message_box( "エラー", "保存できませんでした。\r\n" + file, MB_OK | MB_ICONWARNING, wnd.handle() );
 				}
 			}
 		}
@@ -377,6 +380,9 @@ namespace pmm_lookupper {
 				GetCursorPos( &pt );
 				TrackPopupMenu( GetSubMenu( wnd.popup_, 0 ), TPM_LEFTALIGN, pt.x, pt.y, 0, wnd.handle(), nullptr );
 			}
+			else {
+				wnd.get_result_view()->notify( hdr );
+			}
 		}
 
 		static void on_notify(main_window& wnd, UINT id, NMHDR const* hdr)
@@ -411,6 +417,57 @@ namespace pmm_lookupper {
 			wnd.get_result_view()->set_column_size( 0, static_cast< int >( rv_x * 0.97f ) );
 		}
 
+		static void on_app(main_window& wnd, UINT msg, WPARAM, LPARAM lparam)
+		{
+			switch( msg ) {
+			case wm_query_progress :
+				{
+					std::unique_ptr< query_progress > p( reinterpret_cast< query_progress* >( lparam ) );
+					if( p->generation < wnd.load_generation_ ) {
+						break;
+					}
+
+					if( p->stage == query_stage::scan ) {
+						set_window_text( wnd.handle(), "PMM Lookupper - 読み込み中 " + std::to_string( p->done ) + "/" + std::to_string( p->total ) );
+					}
+					else if( p->stage == query_stage::index && p->done < p->total ) {
+						set_window_text( wnd.handle(), "PMM Lookupper - 索引を作成中" );
+					}
+				}
+				break;
+
+			case wm_query_loaded :
+				{
+					std::unique_ptr< load_report > r( reinterpret_cast< load_report* >( lparam ) );
+					if( r->generation < wnd.load_generation_ || r->errors.empty() ) {
+						break;
+					}
+
+					std::string str( "読み込めないファイルがありました。\r\n" );
+					for( auto const& s : r->errors ) {
+						str += s + "\r\n";
+					}
+
+					message_box( "エラー", str, MB_OK | MB_ICONWARNING );
+				}
+				break;
+
+			case wm_query_result :
+				{
+					std::unique_ptr< query_result > r( reinterpret_cast< query_result* >( lparam ) );
+					if( r->generation < wnd.generation_ ) {
+						break;
+					}
+
+					wnd.get_result_view()->update( std::move( r->strings ), std::move( r->rows ), std::move( r->sources ) );
+					if( r->complete ) {
+						set_window_text( wnd.handle(), "PMM Lookupper" );
+					}
+				}
+				break;
+			}
+		}
+
 		static void on_destroy(main_window& wnd) noexcept
 		{
 			if( wnd.popup_ ) {
@@ -0,0 +1,242 @@
+#ifndef PMM_LOOKUPPER_MAPPED_FILE_HPP_
+#define PMM_LOOKUPPER_MAPPED_FILE_HPP_
+
+#include <vector>
+#include <fstream>
+#include <utility>
+#include <boost/utility/string_ref.hpp>
+
+#ifdef _WIN32
+#	include "winapi.hpp"
+#else
+#	include <fcntl.h>
+#	include <unistd.h>
+#	include <sys/mman.h>
+#	include <sys/stat.h>
+#endif
+
+namespace pmm_lookupper {
+
+	// Narrow path usable with std::fstream.
+	inline std::string native_file_path(boost::string_ref path)
+	{
+#ifdef _WIN32
+		return convert_code( path, CP_UTF8, CP_OEMCP );
+#else
+		return path.to_string();
+#endif
+	}
+
+	// Read-only view of a whole file. The file is memory-mapped when possible and
+	// read into an owned buffer otherwise; either way range() stays valid for the
+	// lifetime of the object.
+	class mapped_file
+	{
+		char const* data_;
+		std::size_t size_;
+		bool opened_;
+		bool mapped_;
+		std::vector< char > buf_;
+
+	public:
+		mapped_file() noexcept :
+			data_( nullptr ), size_( 0 ), opened_( false ), mapped_( false )
+		{ }
+
+		explicit mapped_file(boost::string_ref path) :
+			mapped_file()
+		{
+			if( !map( path ) ) {
+				read( path );
+			}
+		}
+
+		mapped_file(mapped_file&& other) noexcept :
+			data_( other.data_ ), size_( other.size_ ), opened_( other.opened_ ), mapped_( other.mapped_ ),
+			buf_( std::move( other.buf_ ) )
+		{
+			other.data_ = nullptr;
+			other.size_ = 0;
+			other.opened_ = false;
+			other.mapped_ = false;
+		}
+
+		mapped_file& operator=(mapped_file&& other) noexcept
+		{
+			if( this != &other ) {
+				unmap();
+				data_ = other.data_;
+				size_ = other.size_;
+				opened_ = other.opened_;
+				mapped_ = other.mapped_;
+				buf_ = std::move( other.buf_ );
+
+				other.data_ = nullptr;
+				other.size_ = 0;
+				other.opened_ = false;
+				other.mapped_ = false;
+			}
+
+			return *this;
+		}
+
+		mapped_file(mapped_file const&) = delete;
+		mapped_file& operator=(mapped_file const&) = delete;
+
+		~mapped_file() noexcept
+		{
+			unmap();
+		}
+
+		inline boost::string_ref range() const noexcept
+		{
+			return boost::string_ref( data_, size_ );
+		}
+
+		inline std::size_t size() const noexcept
+		{
+			return size_;
+		}
+
+		inline bool empty() const noexcept
+		{
+			return size_ == 0;
+		}
+
+		inline bool is_mapped() const noexcept
+		{
+			return mapped_;
+		}
+
+		inline explicit operator bool() const noexcept
+		{
+			return opened_;
+		}
+
+	private:
+#ifdef _WIN32
+		bool map(boost::string_ref path)
+		{
+			HANDLE const file = CreateFileW(
+				multibyte_to_wide( path, CP_UTF8 ).c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr,
+				OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr
+			);
+			if( file == INVALID_HANDLE_VALUE ) {
+				return false;
+			}
+
+			LARGE_INTEGER sz;
+			if( !GetFileSizeEx( file, &sz ) || static_cast< unsigned long long >( sz.QuadPart ) > static_cast< std::size_t >( -1 ) ) {
+				CloseHandle( file );
+				return false;
+			}
+
+			opened_ = true;
+			if( sz.QuadPart == 0 ) {
+				CloseHandle( file );
+				return true;
+			}
+
+			HANDLE const mapping = CreateFileMappingW( file, nullptr, PAGE_READONLY, 0, 0, nullptr );
+			CloseHandle( file );
+			if( !mapping ) {
+				opened_ = false;
+				return false;
+			}
+
+			auto const p = MapViewOfFile( mapping, FILE_MAP_READ, 0, 0, 0 );
+			CloseHandle( mapping );
+			if( !p ) {
+				opened_ = false;
+				return false;
+			}
+
+			data_ = static_cast< char const* >( p );
+			size_ = static_cast< std::size_t >( sz.QuadPart );
+			mapped_ = true;
+
+			return true;
+		}
+
+		void unmap() noexcept
+		{
+			if( mapped_ ) {
+				UnmapViewOfFile( data_ );
+			}
+		}
+#else
+		bool map(boost::string_ref path)
+		{
+			int const fd = ::open( path.to_string().c_str(), O_RDONLY );
+			if( fd == -1 ) {
+				return false;
+			}
+
+			struct stat st;
+			if( ::fstat( fd, &st ) == -1 || !S_ISREG( st.st_mode ) ) {
+				::close( fd );
+				return false;
+			}
+
+			opened_ = true;
+			if( st.st_size == 0 ) {
+				::close( fd );
+				return true;
+			}
+
+			auto const p = ::mmap( nullptr, static_cast< std::size_t >( st.st_size ), PROT_READ, MAP_PRIVATE, fd, 0 );
+			::close( fd );
+			if( p == MAP_FAILED ) {
+				opened_ = false;
+				return false;
+			}
+
+			::madvise( p, static_cast< std::size_t >( st.st_size ), MADV_SEQUENTIAL );
+
+			data_ = static_cast< char const* >( p );
+			size_ = static_cast< std::size_t >( st.st_size );
+			mapped_ = true;
+
+			return true;
+		}
+
+		void unmap() noexcept
+		{
+			if( mapped_ ) {
+				::munmap( const_cast< char* >( data_ ), size_ );
+			}
+		}
+#endif
+
+		void read(boost::string_ref path)
+		{
+			std::ifstream ifs( native_file_path( path ), std::ios::binary );
+			if( ifs.fail() ) {
+				return;
+			}
+
+			ifs.seekg( 0, std::ios::end );
+			auto const sz = ifs.tellg();
+			ifs.seekg( 0, std::ios::beg );
+			if( sz < 0 ) {
+				return;
+			}
+
+			buf_.resize( static_cast< std::size_t >( sz ) );
+			ifs.read( buf_.data(), buf_.size() );
+			buf_.resize( static_cast< std::size_t >( ifs.gcount() ) );
+
+			data_ = buf_.data();
+			size_ = buf_.size();
+			opened_ = true;
+		}
+	};
+
+	inline mapped_file map_file(boost::string_ref path)
+	{
+		return mapped_file( path );
+	}
+
+} // namespace pmm_lookupper
+
+#endif // PMM_LOOKUPPER_MAPPED_FILE_HPP_
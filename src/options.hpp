@@ -0,0 +1,107 @@
+#ifndef PMM_LOOKUPPER_OPTIONS_HPP_
+#define PMM_LOOKUPPER_OPTIONS_HPP_
+
+#include <string>
+#include <vector>
+#include <boost/optional.hpp>
+#include "query.hpp"
+
+namespace pmm_lookupper {
+
+	char const default_extensions[] = "pmx pmd x wav bmp fx fxsub";
+
+	// Options shared by the window and the console program. Unset fields keep the
+	// defaults of whichever front end uses them.
+	struct command_line_options
+	{
+		boost::optional< std::string > extensions;
+		bool duplication;
+		bool folder_only;
+		boost::optional< sort_order > order;
+		boost::optional< std::string > cache;
+		boost::optional< std::string > stats;
+		bool verify;
+		std::vector< std::string > files;
+	};
+
+	// How -d, -f, -e and -s are told apart from file names. The window has always
+	// taken any argument containing one as the flag, a path like "C:\my-data" too.
+	enum class flag_match
+	{
+		exact,
+		anywhere
+	};
+
+	// argv[0] is the program name.
+	inline command_line_options parse_command_line_options(std::vector< std::string > const& argv, flag_match match = flag_match::exact)
+	{
+		command_line_options opts;
+		opts.duplication = false;
+		opts.folder_only = false;
+		opts.verify = false;
+
+		auto const is_flag = [match](std::string const& arg, char const* flag) {
+			return match == flag_match::exact ? arg == flag : arg.find( flag ) != arg.npos;
+		};
+
+		for( std::size_t i = 1; i < argv.size(); ++i ) {
+			// Long options first, since the short ones may match anywhere in an argument.
+			if( argv[i].compare( 0, 8, "--cache=" ) == 0 ) {
+				opts.cache = argv[i].substr( 8 );
+			}
+			else if( argv[i].compare( 0, 8, "--stats=" ) == 0 ) {
+				opts.stats = argv[i].substr( 8 );
+			}
+			else if( argv[i] == "--verify" ) {
+				opts.verify = true;
+			}
+			else if( is_flag( argv[i], "-d" ) ) {
+				opts.duplication = true;
+			}
+			else if( is_flag( argv[i], "-f" ) ) {
+				opts.folder_only = true;
+			}
+			else if( is_flag( argv[i], "-e" ) ) {
+				if( i + 1 == argv.size() ) {
+					break;
+				}
+				opts.extensions = argv[i + 1];
+				++i;
+			}
+			else if( is_flag( argv[i], "-s" ) ) {
+				if( i + 1 == argv.size() ) {
+					break;
+				}
+				if( argv[i + 1] == "path" ) {
+					opts.order = sort_order::path;
+				}
+				else if( argv[i + 1] == "ext" ) {
+					opts.order = sort_order::extension;
+				}
+				else if( argv[i + 1] == "input" ) {
+					opts.order = sort_order::input;
+				}
+				++i;
+			}
+			else {
+				opts.files.push_back( argv[i] );
+			}
+		}
+
+		return opts;
+	}
+
+	inline query_options to_query_options(command_line_options const& opts)
+	{
+		query_options q;
+		q.extensions = parse_extensions( opts.extensions ? *opts.extensions : std::string( default_extensions ) );
+		q.folder_only = opts.folder_only;
+		q.duplication = opts.duplication;
+		q.order = opts.order ? *opts.order : sort_order::path;
+
+		return q;
+	}
+
+} // namespace pmm_lookupper
+
+#endif // PMM_LOOKUPPER_OPTIONS_HPP_
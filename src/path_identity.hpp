@@ -0,0 +1,143 @@
+#ifndef PMM_LOOKUPPER_PATH_IDENTITY_HPP_
+#define PMM_LOOKUPPER_PATH_IDENTITY_HPP_
+
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <boost/utility/string_ref.hpp>
+#include "string_pool.hpp"
+
+namespace pmm_lookupper {
+
+	// The form under which Windows names the same file: '/' and '\' are one
+	// separator, empty and "." components are dropped, ".." removes the previous
+	// component (never the drive), and ASCII letters, the drive letter included,
+	// are folded to lower case. "C:\MMD\Model\..\Model\a.pmx" -> "c:\mmd\model\a.pmx"
+	// Only ASCII case is folded: full-width letters and other scripts keep theirs,
+	// although NTFS would take them for the same name.
+	inline std::string fold_path(boost::string_ref path)
+	{
+		auto const is_sep = [](char c) { return c == '\\' || c == '/'; };
+
+		std::string result;
+		result.reserve( path.size() );
+
+		std::size_t i = 0;
+		for( ; i < path.size() && is_sep( path[i] ); ++i ) {
+			result += '\\';
+		}
+		auto const root = result.size();
+
+		// Where each component starts; the first keep are never removed.
+		std::vector< std::size_t > starts;
+		std::size_t keep = 0;
+
+		while( i < path.size() ) {
+			auto j = i;
+			while( j < path.size() && !is_sep( path[j] ) ) {
+				++j;
+			}
+			auto const part = path.substr( i, j - i );
+			i = j + 1;
+
+			if( part.empty() || part == "." ) {
+				continue;
+			}
+			if( part == ".." ) {
+				if( starts.size() > keep ) {
+					result.resize( starts.back() );
+					starts.pop_back();
+				}
+				continue;
+			}
+
+			starts.push_back( result.size() );
+			if( result.size() > root ) {
+				result += '\\';
+			}
+			for( auto const c : part ) {
+				result += c >= 'A' && c <= 'Z' ? static_cast< char >( c - 'A' + 'a' ) : c;
+			}
+
+			if( starts.size() == 1 && root == 0 && part.size() == 2 && part[1] == ':' ) {
+				keep = 1;
+			}
+		}
+
+		return result;
+	}
+
+	// Dense ids of files: paths get the same id exactly when their folded forms
+	// are equal. The folded text is kept and compared, not only hashed.
+	class path_identities
+	{
+		string_pool folded_;
+
+	public:
+		inline std::size_t size() const noexcept
+		{
+			return folded_.size();
+		}
+
+		string_id identify(boost::string_ref path)
+		{
+			return folded_.intern( fold_path( path ) );
+		}
+
+		// True when no path added before names the same file.
+		bool add(boost::string_ref path)
+		{
+			auto const n = folded_.size();
+			identify( path );
+
+			return folded_.size() > n;
+		}
+	};
+
+	// For every id of a pool, the first id of data that names the same file, or the
+	// id itself when it is not in data. Files are told apart by path_identities.
+	class path_aliases
+	{
+		std::vector< string_id > first_;
+
+	public:
+		path_aliases() = default;
+
+		path_aliases(id_list const& data, string_pool const& pool) :
+			first_( pool.size() )
+		{
+			for( std::size_t i = 0; i < first_.size(); ++i ) {
+				first_[i] = static_cast< string_id >( i );
+			}
+
+			std::vector< char > seen( pool.size(), 0 );
+			path_identities files;
+			id_list firsts;
+			for( auto const id : data ) {
+				if( seen[id] ) {
+					continue;
+				}
+				seen[id] = 1;
+				auto const file = files.identify( pool[id] );
+				if( file == firsts.size() ) {
+					firsts.push_back( id );
+				}
+				first_[id] = firsts[file];
+			}
+		}
+
+		// True when id is the first of data to name its file.
+		inline bool is_first(string_id id) const noexcept
+		{
+			return id >= first_.size() || first_[id] == id;
+		}
+
+		inline string_id first(string_id id) const noexcept
+		{
+			return id < first_.size() ? first_[id] : id;
+		}
+	};
+
+} // namespace pmm_lookupper
+
+#endif // PMM_LOOKUPPER_PATH_IDENTITY_HPP_
@@ -0,0 +1,86 @@
+#ifndef PMM_LOOKUPPER_PATH_LIST_HPP_
+#define PMM_LOOKUPPER_PATH_LIST_HPP_
+
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <boost/utility/string_ref.hpp>
+#include "scanner.hpp"
+
+namespace pmm_lookupper {
+
+	// Paths in the encoding they were found in, packed into a single buffer.
+	class path_list
+	{
+		std::string bytes_;
+		std::vector< path_span > spans_;
+
+	public:
+		inline std::size_t size() const noexcept
+		{
+			return spans_.size();
+		}
+
+		inline bool empty() const noexcept
+		{
+			return spans_.empty();
+		}
+
+		inline boost::string_ref operator[](std::size_t i) const noexcept
+		{
+			return span_ref( bytes_, spans_[i] );
+		}
+
+		void clear() noexcept
+		{
+			bytes_.clear();
+			spans_.clear();
+		}
+
+		void push_back(boost::string_ref path)
+		{
+			spans_.push_back( { bytes_.size(), path.size() } );
+			bytes_.append( path.begin(), path.end() );
+		}
+
+		template <class Pred>
+		void append(boost::string_ref buf, std::vector< path_span > const& spans, Pred pred)
+		{
+			for( auto const& s : spans ) {
+				auto const path = span_ref( buf, s );
+				if( pred( path ) ) {
+					push_back( path );
+				}
+			}
+		}
+
+		void append(boost::string_ref buf, std::vector< path_span > const& spans)
+		{
+			append( buf, spans, [](boost::string_ref) { return true; } );
+		}
+
+		void append(path_list const& other)
+		{
+			for( auto const& s : other.spans_ ) {
+				spans_.push_back( { bytes_.size() + s.offset, s.length } );
+			}
+			bytes_ += other.bytes_;
+		}
+	};
+
+	struct string_ref_hash
+	{
+		inline std::size_t operator()(boost::string_ref str) const noexcept
+		{
+			std::uint64_t h = 14695981039346656037ull;
+			for( auto const c : str ) {
+				h = ( h ^ static_cast< unsigned char >( c ) ) * 1099511628211ull;
+			}
+
+			return static_cast< std::size_t >( h );
+		}
+	};
+
+} // namespace pmm_lookupper
+
+#endif // PMM_LOOKUPPER_PATH_LIST_HPP_
@@ -0,0 +1,53 @@
+#ifndef PMM_LOOKUPPER_PATH_SOURCES_HPP_
+#define PMM_LOOKUPPER_PATH_SOURCES_HPP_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "engine.hpp"
+#include "query.hpp"
+#include "string_pool.hpp"
+
+namespace pmm_lookupper {
+
+	// The loaded paths with the project each came from: ids are the paths of every
+	// project in order, as crawl_files merges them, and ids[i] was found in
+	// files[file_of[i]].
+	struct path_sources
+	{
+		std::vector< std::string > files;
+		id_list ids;
+		std::vector< std::uint32_t > file_of;
+	};
+
+	inline path_sources intern_projects(std::vector< project > const& projects, string_pool& pool)
+	{
+		path_sources result;
+		result.files.reserve( projects.size() );
+
+		path_list paths;
+		for( auto const& p : projects ) {
+			result.file_of.insert( result.file_of.end(), p.result.paths.size(), static_cast< std::uint32_t >( result.files.size() ) );
+			result.files.push_back( p.file );
+			paths.append( p.result.paths );
+		}
+		result.ids = intern_paths( paths, pool );
+
+		return result;
+	}
+
+	inline std::vector< std::string > load_errors(std::vector< project > const& projects)
+	{
+		std::vector< std::string > result;
+		for( auto const& p : projects ) {
+			if( p.result.error ) {
+				result.push_back( p.file );
+			}
+		}
+
+		return result;
+	}
+
+} // namespace pmm_lookupper
+
+#endif // PMM_LOOKUPPER_PATH_SOURCES_HPP_
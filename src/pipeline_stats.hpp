@@ -0,0 +1,303 @@
+#ifndef PMM_LOOKUPPER_PIPELINE_STATS_HPP_
+#define PMM_LOOKUPPER_PIPELINE_STATS_HPP_
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace pmm_lookupper {
+
+	enum class stat_counter
+	{
+		files_read,
+		bytes_read,
+		candidates,
+		paths_emitted,
+		filtered_out,
+		duplicates_removed,
+		size_
+	};
+
+	// Files are mapped and read on first touch: read covers mapping and hashing,
+	// and scan includes the page faults of files parsed without being hashed.
+	// Deduplication runs in the same pass as the filter and is timed with it, as
+	// are whole filter_engine queries, whose buckets are sorted by index. folders
+	// is the lookup of folder-only results, which stats every path.
+	enum class stat_stage
+	{
+		read,
+		scan,
+		convert,
+		index,
+		filter,
+		folders,
+		sort,
+		size_
+	};
+
+	inline char const* stat_name(stat_counter c) noexcept
+	{
+		static char const* const names[] = {
+			"files_read", "bytes_read", "candidates", "paths_emitted", "filtered_out", "duplicates_removed"
+		};
+		return names[static_cast< std::size_t >( c )];
+	}
+
+	inline char const* stat_name(stat_stage s) noexcept
+	{
+		static char const* const names[] = { "read", "scan", "convert", "index", "filter", "folders", "sort" };
+		return names[static_cast< std::size_t >( s )];
+	}
+
+	// Latencies in power-of-two buckets of nanoseconds; bucket i holds [2^(i-1), 2^i).
+	class latency_histogram
+	{
+	public:
+		static std::size_t const buckets = 48;
+
+	private:
+		std::array< std::atomic< std::uint64_t >, buckets > counts_;
+		std::atomic< std::uint64_t > total_ns_;
+		std::atomic< std::uint64_t > max_ns_;
+
+	public:
+		latency_histogram() noexcept
+		{
+			reset();
+		}
+
+		void record(std::uint64_t ns) noexcept
+		{
+			std::size_t i = 0;
+			while( i + 1 < buckets && ( ns >> i ) != 0 ) {
+				++i;
+			}
+			counts_[i].fetch_add( 1, std::memory_order_relaxed );
+			total_ns_.fetch_add( ns, std::memory_order_relaxed );
+
+			auto max = max_ns_.load( std::memory_order_relaxed );
+			while( ns > max && !max_ns_.compare_exchange_weak( max, ns, std::memory_order_relaxed ) ) {
+			}
+		}
+
+		void reset() noexcept
+		{
+			for( auto& c : counts_ ) {
+				c.store( 0, std::memory_order_relaxed );
+			}
+			total_ns_.store( 0, std::memory_order_relaxed );
+			max_ns_.store( 0, std::memory_order_relaxed );
+		}
+
+		inline std::uint64_t count(std::size_t bucket) const noexcept
+		{
+			return counts_[bucket].load( std::memory_order_relaxed );
+		}
+
+		// Exclusive upper bound of a bucket.
+		static inline std::uint64_t upper_ns(std::size_t bucket) noexcept
+		{
+			return std::uint64_t( 1 ) << bucket;
+		}
+
+		std::uint64_t count() const noexcept
+		{
+			std::uint64_t n = 0;
+			for( auto const& c : counts_ ) {
+				n += c.load( std::memory_order_relaxed );
+			}
+			return n;
+		}
+
+		inline std::uint64_t total_ns() const noexcept
+		{
+			return total_ns_.load( std::memory_order_relaxed );
+		}
+
+		inline std::uint64_t max_ns() const noexcept
+		{
+			return max_ns_.load( std::memory_order_relaxed );
+		}
+
+		// Upper bound of the bucket holding the p-th percentile.
+		std::uint64_t percentile_ns(double p) const noexcept
+		{
+			auto const n = count();
+			if( n == 0 ) {
+				return 0;
+			}
+
+			auto const rank = static_cast< std::uint64_t >( p / 100.0 * n + 0.999999 );
+			std::uint64_t seen = 0;
+			for( std::size_t i = 0; i < buckets; ++i ) {
+				seen += count( i );
+				if( seen >= rank ) {
+					return upper_ns( i );
+				}
+			}
+			return upper_ns( buckets - 1 );
+		}
+	};
+
+	// Counters and latencies of every stage of a load and its queries. Updated
+	// from any thread while installed; see install_pipeline_stats.
+	class pipeline_stats
+	{
+		std::array< std::atomic< std::uint64_t >, static_cast< std::size_t >( stat_counter::size_ ) > counters_;
+		std::array< latency_histogram, static_cast< std::size_t >( stat_stage::size_ ) > stages_;
+
+	public:
+		pipeline_stats() noexcept
+		{
+			reset();
+		}
+
+		pipeline_stats(pipeline_stats const&) = delete;
+		pipeline_stats& operator=(pipeline_stats const&) = delete;
+
+		inline void add(stat_counter c, std::uint64_t n) noexcept
+		{
+			counters_[static_cast< std::size_t >( c )].fetch_add( n, std::memory_order_relaxed );
+		}
+
+		inline void record(stat_stage s, std::chrono::steady_clock::duration d) noexcept
+		{
+			stages_[static_cast< std::size_t >( s )].record(
+				static_cast< std::uint64_t >( std::chrono::duration_cast< std::chrono::nanoseconds >( d ).count() )
+			);
+		}
+
+		inline std::uint64_t get(stat_counter c) const noexcept
+		{
+			return counters_[static_cast< std::size_t >( c )].load( std::memory_order_relaxed );
+		}
+
+		inline latency_histogram const& get(stat_stage s) const noexcept
+		{
+			return stages_[static_cast< std::size_t >( s )];
+		}
+
+		void reset() noexcept
+		{
+			for( auto& c : counters_ ) {
+				c.store( 0, std::memory_order_relaxed );
+			}
+			for( auto& s : stages_ ) {
+				s.reset();
+			}
+		}
+
+		// {"counters":{...},"stages":{"read":{"count":..,"total_ns":..,"max_ns":..,
+		// "p50_ns":..,"p99_ns":..,"histogram":[[upper_ns,count],...]},...}}
+		// The histogram lists non-empty buckets only.
+		std::string to_json() const
+		{
+			std::string json( "{\"counters\":{" );
+			for( std::size_t i = 0; i < counters_.size(); ++i ) {
+				auto const c = static_cast< stat_counter >( i );
+				json += ( i ? ",\"" : "\"" ) + std::string( stat_name( c ) ) + "\":" + std::to_string( get( c ) );
+			}
+
+			json += "},\"stages\":{";
+			for( std::size_t i = 0; i < stages_.size(); ++i ) {
+				auto const s = static_cast< stat_stage >( i );
+				auto const& h = get( s );
+				json += ( i ? ",\"" : "\"" ) + std::string( stat_name( s ) ) + "\":{"
+					+ "\"count\":" + std::to_string( h.count() )
+					+ ",\"total_ns\":" + std::to_string( h.total_ns() )
+					+ ",\"max_ns\":" + std::to_string( h.max_ns() )
+					+ ",\"p50_ns\":" + std::to_string( h.percentile_ns( 50.0 ) )
+					+ ",\"p99_ns\":" + std::to_string( h.percentile_ns( 99.0 ) )
+					+ ",\"histogram\":[";
+
+				bool first = true;
+				for( std::size_t b = 0; b < latency_histogram::buckets; ++b ) {
+					if( h.count( b ) == 0 ) {
+						continue;
+					}
+					json += ( first ? "[" : ",[" ) + std::to_string( latency_histogram::upper_ns( b ) ) + "," + std::to_string( h.count( b ) ) + "]";
+					first = false;
+				}
+				json += "]}";
+			}
+			json += "}}";
+
+			return json;
+		}
+	};
+
+namespace detail {
+
+	inline std::atomic< pipeline_stats* >& stats_hook() noexcept
+	{
+		static std::atomic< pipeline_stats* > p( nullptr );
+		return p;
+	}
+
+} // namespace detail
+
+	// Stats are collected into s from every thread until nullptr is installed;
+	// s must outlive any load or query that may still be running. With nothing
+	// installed each instrumented call costs one relaxed load.
+	inline void install_pipeline_stats(pipeline_stats* s) noexcept
+	{
+		detail::stats_hook().store( s, std::memory_order_release );
+	}
+
+	inline pipeline_stats* installed_pipeline_stats() noexcept
+	{
+		return detail::stats_hook().load( std::memory_order_relaxed );
+	}
+
+	inline void count_stat(stat_counter c, std::uint64_t n) noexcept
+	{
+		if( auto const s = installed_pipeline_stats() ) {
+			s->add( c, n );
+		}
+	}
+
+	// Records the time until destruction as one run of a stage.
+	class stage_timer
+	{
+		pipeline_stats* stats_;
+		stat_stage stage_;
+		std::chrono::steady_clock::time_point start_;
+
+	public:
+		explicit stage_timer(stat_stage stage) noexcept :
+			stats_( installed_pipeline_stats() ), stage_( stage )
+		{
+			if( stats_ ) {
+				start_ = std::chrono::steady_clock::now();
+			}
+		}
+
+		stage_timer(stage_timer const&) = delete;
+		stage_timer& operator=(stage_timer const&) = delete;
+
+		~stage_timer()
+		{
+			stop();
+		}
+
+		// Records now instead of at destruction.
+		void stop() noexcept
+		{
+			if( stats_ ) {
+				stats_->record( stage_, std::chrono::steady_clock::now() - start_ );
+				stats_ = nullptr;
+			}
+		}
+
+		inline bool active() const noexcept
+		{
+			return stats_ != nullptr;
+		}
+	};
+
+} // namespace pmm_lookupper
+
+#endif // PMM_LOOKUPPER_PIPELINE_STATS_HPP_
@@ -1,19 +1,24 @@
 #ifndef PMM_LOOKUPPER_PMM_HPP_
 #define PMM_LOOKUPPER_PMM_HPP_
 
+#include <cstdint>
+#include <istream>
 #include <string>
+#include <utility>
 #include <vector>
 #include <tuple>
+#include <array>
 #include <fstream>
 #include <boost/utility/string_ref.hpp>
 #include <boost/variant.hpp>
+#include <boost/optional.hpp>
 #include "file.hpp"
 
 namespace pmm_lookupper {
 
 namespace {
 
-	inline bool is_pmm_file(std::vector< char > const& buf) noexcept
+	inline bool is_pmm_file(boost::string_ref buf) noexcept
 	{
 		boost::string_ref const sig( "Polygon Movie maker 000" );
 
@@ -26,14 +31,461 @@ namespace {
 
 } // namespace 
 
-	inline std::vector< std::string > pmm_contain_file_paths(boost::string_ref path)
+namespace detail {
+
+	// The bytes of a buffer, as pmm_reader reads them.
+	struct pmm_buffer_source
+	{
+		boost::string_ref buf;
+
+		inline std::uint64_t size() const noexcept
+		{
+			return buf.size();
+		}
+
+		inline boost::string_ref read(std::uint64_t pos, std::size_t n) noexcept
+		{
+			return buf.substr( static_cast< std::size_t >( pos ), n );
+		}
+	};
+
+	// The bytes of a stream of a known size, read as they are asked for. What
+	// read returns is valid until the next read.
+	class pmm_stream_source
+	{
+		std::istream& is_;
+		std::uint64_t size_;
+		std::uint64_t pos_;
+		std::string buf_;
+
+	public:
+		pmm_stream_source(std::istream& is, std::uint64_t size) :
+			is_( is ), size_( size ), pos_( 0 )
+		{
+			is_.seekg( 0, std::ios::beg );
+		}
+
+		inline std::uint64_t size() const noexcept
+		{
+			return size_;
+		}
+
+		boost::string_ref read(std::uint64_t pos, std::size_t n)
+		{
+			if( pos != pos_ ) {
+				is_.seekg( static_cast< std::streamoff >( pos ), std::ios::beg );
+			}
+			buf_.resize( n );
+			is_.read( &buf_[0], static_cast< std::streamsize >( n ) );
+			auto const got = static_cast< std::size_t >( is_.gcount() );
+			pos_ = pos + got;
+
+			return boost::string_ref( buf_.data(), got );
+		}
+	};
+
+	// Bounds-checked little-endian cursor. Any read past the end puts it in the
+	// failed state and every later read is a no-op.
+	template <class Source>
+	class basic_pmm_reader
+	{
+		Source src_;
+		std::uint64_t pos_;
+		bool ok_;
+
+	public:
+		basic_pmm_reader(Source src, std::uint64_t pos) :
+			src_( std::move( src ) ), pos_( pos ), ok_( pos <= src_.size() )
+		{ }
+
+		inline bool ok() const noexcept
+		{
+			return ok_;
+		}
+
+		inline std::uint64_t pos() const noexcept
+		{
+			return pos_;
+		}
+
+		inline std::uint64_t remaining() const noexcept
+		{
+			return ok_ ? src_.size() - pos_ : 0;
+		}
+
+		void fail() noexcept
+		{
+			ok_ = false;
+		}
+
+		void skip(std::uint64_t n) noexcept
+		{
+			if( n > remaining() ) {
+				ok_ = false;
+				return;
+			}
+			pos_ += n;
+		}
+
+		std::uint8_t u8()
+		{
+			auto const b = bytes( 1 );
+			return b.empty() ? 0 : static_cast< std::uint8_t >( b[0] );
+		}
+
+		std::int32_t i32()
+		{
+			auto const b = bytes( 4 );
+			if( b.empty() ) {
+				return 0;
+			}
+
+			std::uint32_t v = 0;
+			for( int i = 3; i >= 0; --i ) {
+				v = ( v << 8 ) | static_cast< std::uint8_t >( b[i] );
+			}
+
+			return static_cast< std::int32_t >( v );
+		}
+
+		// Element count followed by elements of at least elem_size bytes each.
+		std::size_t count(std::size_t elem_size)
+		{
+			auto const n = i32();
+			if( n < 0 || static_cast< std::uint64_t >( n ) > remaining() / ( elem_size ? elem_size : 1 ) ) {
+				ok_ = false;
+				return 0;
+			}
+
+			return static_cast< std::size_t >( n );
+		}
+
+		void skip_array(std::uint64_t n, std::uint64_t elem_size) noexcept
+		{
+			if( elem_size && n > remaining() / elem_size ) {
+				ok_ = false;
+				return;
+			}
+			skip( n * elem_size );
+		}
+
+		// PMM v2 strings: one length byte followed by the bytes.
+		void skip_vstring()
+		{
+			skip( u8() );
+		}
+
+		// Fixed-size, NUL-terminated path field. Each path in it is passed to f with
+		// its offset in the source; empty fields have none.
+		template <class F>
+		void path_field(F f)
+		{
+			std::size_t const field_size = 256;
+			auto const at = pos_;
+			auto const field = bytes( field_size );
+			if( field.empty() ) {
+				return;
+			}
+
+			auto const len = field.find( '\0' );
+			if( len == field.npos ) {
+				ok_ = false;
+				return;
+			}
+
+			for_each_file_path( field.substr( 0, len ), '\0', [&](boost::string_ref p) {
+				f( at + static_cast< std::uint64_t >( p.data() - field.data() ), p );
+			} );
+		}
+
+	private:
+		// Empty, and failed, when fewer than n bytes are left or cannot be read.
+		boost::string_ref bytes(std::size_t n)
+		{
+			if( remaining() < n ) {
+				ok_ = false;
+				return {};
+			}
+
+			auto const b = src_.read( pos_, n );
+			if( b.size() != n ) {
+				ok_ = false;
+				return {};
+			}
+			pos_ += n;
+
+			return b;
+		}
+	};
+
+	using pmm_reader = basic_pmm_reader< pmm_buffer_source >;
+	using pmm_stream_reader = basic_pmm_reader< pmm_stream_source >;
+
+	namespace pmm_layout {
+
+		std::size_t const header = 30;
+		std::size_t const name_v1 = 20;
+		std::size_t const accessory_name = 100;
+
+		std::size_t const bone_frame = 58;
+		std::size_t const morph_frame = 17;
+		std::size_t const op_frame_base = 14;
+		std::size_t const keyframe_index = 4;
+		std::size_t const bone_current = 31;
+		std::size_t const camera_frame = 78;
+		std::size_t const camera_current = 37;
+		std::size_t const light_frame = 37;
+		std::size_t const light_current = 25;
+		std::size_t const accessory_frame = 51;
+		std::size_t const accessory_current = 38;
+
+	} // namespace pmm_layout
+
+	template <class Reader>
+	inline void skip_pmm_name(Reader& r, int version)
+	{
+		if( version == 1 ) {
+			r.skip( pmm_layout::name_v1 );
+		}
+		else {
+			r.skip_vstring();
+		}
+	}
+
+	template <class Reader, class F>
+	inline void parse_pmm_model(Reader& r, int version, F const& add)
+	{
+		namespace l = pmm_layout;
+
+		r.u8();
+		skip_pmm_name( r, version );
+		if( version != 1 ) {
+			r.skip_vstring();
+		}
+		r.path_field( add );
+		r.u8();
+
+		auto const bones = r.count( version == 1 ? l::name_v1 : 1 );
+		for( std::size_t i = 0; i < bones && r.ok(); ++i ) {
+			skip_pmm_name( r, version );
+		}
+		auto const morphs = r.count( version == 1 ? l::name_v1 : 1 );
+		for( std::size_t i = 0; i < morphs && r.ok(); ++i ) {
+			skip_pmm_name( r, version );
+		}
+		auto const iks = r.count( 4 );
+		r.skip_array( iks, 4 );
+		auto const ops = r.count( 4 );
+		r.skip_array( ops, 4 );
+
+		r.skip( 1 + 1 + 4 + 16 );
+		r.skip( r.u8() );
+		r.skip( 4 + 4 );
+
+		// Keyframes: the bulk of a scene and never a path.
+		r.skip_array( bones, l::bone_frame );
+		r.skip_array( r.count( l::keyframe_index + l::bone_frame ), l::keyframe_index + l::bone_frame );
+		r.skip_array( morphs, l::morph_frame );
+		r.skip_array( r.count( l::keyframe_index + l::morph_frame ), l::keyframe_index + l::morph_frame );
+
+		auto const op_frame = l::op_frame_base + iks + ops * 8;
+		r.skip( op_frame );
+		r.skip_array( r.count( l::keyframe_index + op_frame ), l::keyframe_index + op_frame );
+
+		r.skip_array( bones, l::bone_current );
+		r.skip_array( morphs, 4 );
+		r.skip( iks );
+		r.skip_array( ops, 8 );
+		r.skip( 1 + 4 + 1 + 1 );
+	}
+
+	template <class Reader, class F>
+	inline void parse_pmm_accessory(Reader& r, F const& add)
+	{
+		namespace l = pmm_layout;
+
+		r.u8();
+		r.skip( l::accessory_name );
+		r.path_field( add );
+		r.u8();
+		r.skip( l::accessory_frame );
+		r.skip_array( r.count( l::keyframe_index + l::accessory_frame ), l::keyframe_index + l::accessory_frame );
+		r.skip( l::accessory_current );
+		r.u8();
+	}
+
+	inline int pmm_version(boost::string_ref buf) noexcept
+	{
+		if( buf.size() < pmm_layout::header ) {
+			return 0;
+		}
+
+		switch( buf[23] ) {
+		case '1' :
+			return 1;
+		case '2' :
+			return 2;
+		}
+
+		return 0;
+	}
+
+	// Walks the model and accessory tables of a PMM file of the given version up to
+	// the settings block, passing each path field's paths to add. Returns false
+	// when the layout does not check out.
+	template <class Reader, class F>
+	inline bool walk_pmm_layout(Reader& r, int version, F const& add)
+	{
+		namespace l = pmm_layout;
+
+		r.skip( 4 + 4 + 4 + 4 + 7 );
+		r.u8();
+		auto const models = r.u8();
+		for( std::size_t i = 0; i < models && r.ok(); ++i ) {
+			parse_pmm_model( r, version, add );
+		}
+
+		r.skip( l::camera_frame );
+		r.skip_array( r.count( l::keyframe_index + l::camera_frame ), l::keyframe_index + l::camera_frame );
+		r.skip( l::camera_current );
+		r.skip( l::light_frame );
+		r.skip_array( r.count( l::keyframe_index + l::light_frame ), l::keyframe_index + l::light_frame );
+		r.skip( l::light_current );
+
+		r.u8();
+		r.i32();
+		auto const accessories = r.u8();
+		r.skip_array( accessories, l::accessory_name );
+		for( std::size_t i = 0; i < accessories && r.ok(); ++i ) {
+			parse_pmm_accessory( r, add );
+		}
+
+		return r.ok();
+	}
+
+} // namespace detail
+
+	// Walks the model and accessory tables of a PMM v1/v2 file and reads their path
+	// fields directly, skipping the keyframe data. The trailing settings block
+	// (wave, background video and image paths) is small and is scanned as before.
+	// Returns none for unknown versions or when the layout does not check out.
+	inline boost::optional< std::vector< path_span > > parse_pmm_path_spans(boost::string_ref buf)
+	{
+		auto const version = detail::pmm_version( buf );
+		if( version == 0 ) {
+			return boost::none;
+		}
+
+		std::vector< path_span > result;
+		detail::pmm_reader r( detail::pmm_buffer_source{ buf }, detail::pmm_layout::header );
+		auto const add = [&](std::uint64_t offset, boost::string_ref p) {
+			result.push_back( { static_cast< std::size_t >( offset ), p.size() } );
+		};
+		if( !detail::walk_pmm_layout( r, version, add ) ) {
+			return boost::none;
+		}
+
+		auto const tail = buf.substr( static_cast< std::size_t >( r.pos() ) );
+		for_each_file_path( tail, '\0', [&](boost::string_ref p) {
+			result.push_back( { static_cast< std::size_t >( p.data() - buf.data() ), p.size() } );
+		} );
+
+		return result;
+	}
+
+	inline std::vector< path_span > pmm_path_spans(boost::string_ref buf)
+	{
+		auto spans = parse_pmm_path_spans( buf );
+		if( spans ) {
+			return std::move( *spans );
+		}
+
+		return find_path_spans( buf, '\0' );
+	}
+
+	// Paths in the contents of a .pmm, or none when buf is not one.
+	inline boost::optional< path_list > parse_pmm_buffer(boost::string_ref buf)
 	{
-		auto const buf = read_file( path );
 		if( buf.empty() || !is_pmm_file( buf ) ) {
+			return boost::none;
+		}
+
+		path_list result;
+		result.append( buf, pmm_path_spans( buf ) );
+
+		return result;
+	}
+
+	inline path_list pmm_contain_file_paths(boost::string_ref path)
+	{
+		auto const file = map_file( path );
+		auto result = parse_pmm_buffer( file.range() );
+		if( !result ) {
+			return {};
+		}
+
+		return std::move( *result );
+	}
+
+	// Files of at least this size are scanned by parse_pmm_stream instead of being
+	// mapped, which a 32-bit build cannot do for them.
+	std::uint64_t const pmm_stream_size = 512 * 1024 * 1024;
+
+	// The paths parse_pmm_buffer finds, read through a fixed-size window instead
+	// of the whole file, for inputs too large to keep resident. The layout is
+	// walked by seeking over the keyframes. None when path is not a .pmm.
+	inline boost::optional< path_list > parse_pmm_stream(
+		boost::string_ref path, std::size_t window_size = 64 * 1024
+	) {
+		std::ifstream ifs( native_file_path( path ), std::ios::binary );
+		if( ifs.fail() ) {
+			return boost::none;
+		}
+
+		std::array< char, detail::pmm_layout::header > head;
+		ifs.read( head.data(), head.size() );
+		boost::string_ref const head_ref( head.data(), static_cast< std::size_t >( ifs.gcount() ) );
+		if( !is_pmm_file( head_ref ) ) {
+			return boost::none;
+		}
+		ifs.clear();
+		ifs.seekg( 0, std::ios::end );
+		auto const size = static_cast< std::uint64_t >( ifs.tellg() );
+
+		path_list result;
+		std::uint64_t tail = 0;
+		auto const version = detail::pmm_version( head_ref );
+		if( version != 0 ) {
+			detail::pmm_stream_reader r( detail::pmm_stream_source( ifs, size ), detail::pmm_layout::header );
+			auto const add = [&](std::uint64_t, boost::string_ref p) {
+				result.push_back( p );
+			};
+			if( detail::walk_pmm_layout( r, version, add ) ) {
+				tail = r.pos();
+			}
+			else {
+				result.clear();
+			}
+		}
+
+		ifs.clear();
+		ifs.seekg( static_cast< std::streamoff >( tail ), std::ios::beg );
+		for_each_file_path( ifs, '\0', [&](boost::string_ref p) {
+			result.push_back( p );
+		}, window_size );
+
+		return result;
+	}
+
+	inline path_list pmm_contain_file_paths_streamed(
+		boost::string_ref path, std::size_t window_size = 64 * 1024
+	) {
+		auto result = parse_pmm_stream( path, window_size );
+		if( !result ) {
 			return {};
 		}
 
-		return { find_file_paths( buf, '\0' ) };
+		return std::move( *result );
 	}
 
 } // namespace pmm_lookupper
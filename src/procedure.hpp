@@ -53,6 +53,11 @@ namespace pmm_lookupper {
 				return TRUE;
 			}
 
+			if( msg >= WM_APP && msg <= 0xbfff ) {
+				obj->event().invoke( event::app(), *obj, msg, wparam, lparam );
+				return TRUE;
+			}
+
 			return FALSE;
 		}
 	};
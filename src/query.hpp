@@ -0,0 +1,263 @@
+#ifndef PMM_LOOKUPPER_QUERY_HPP_
+#define PMM_LOOKUPPER_QUERY_HPP_
+
+#include <algorithm>
+#include <string>
+#include <vector>
+#include <boost/range/algorithm.hpp>
+#include <boost/utility/string_ref.hpp>
+#include <boost/spirit/include/qi.hpp>
+#include "cancel_token.hpp"
+#include "file.hpp"
+#include "filter.hpp"
+#include "path_identity.hpp"
+#include "path_list.hpp"
+#include "pipeline_stats.hpp"
+#include "sort_keys.hpp"
+#include "stat_cache.hpp"
+#include "string_pool.hpp"
+
+namespace pmm_lookupper {
+
+	enum class sort_order
+	{
+		path,
+		extension,
+		input
+	};
+
+	struct query_options
+	{
+		std::vector< std::string > extensions;
+		bool folder_only;
+		bool duplication;
+		sort_order order;
+	};
+
+	// "pmx  FX" -> { ".pmx", ".fx" }
+	inline std::vector< std::string > parse_extensions(std::string const& str)
+	{
+		namespace qi = boost::spirit::qi;
+
+		std::vector< std::string > exts;
+
+		auto const parser = boost::proto::deep_copy(
+			qi::as< std::vector< std::string > >()[ +qi::alnum % qi::omit[+qi::lit( ' ' )] ]
+		);
+		qi::parse( str.begin(), str.end(), parser, exts );
+
+		for( auto& ext : exts ) {
+			ext = fold_extension( std::string( "." ) + ext );
+		}
+
+		return exts;
+	}
+
+	// Ids of the UTF-8 forms of data, in order and with duplicates.
+	inline id_list intern_paths(path_list const& data, string_pool& pool)
+	{
+		id_list result;
+		result.reserve( data.size() );
+
+		stage_timer timer( stat_stage::convert );
+		std::string buf;
+		for( std::size_t i = 0; i < data.size(); ++i ) {
+			buf.clear();
+			cp932_to_utf8( data[i], buf );
+			result.push_back( pool.intern( buf ) );
+		}
+
+		return result;
+	}
+
+	// The id of the folder containing each path of data, indexed by id. Folders are
+	// interned here, up front, so that folder queries only read the pool, which may
+	// be shared by then. Other ids map to 0.
+	inline id_list intern_folders(id_list const& data, string_pool& pool)
+	{
+		id_list result( pool.size(), 0 );
+		std::vector< char > done( pool.size(), 0 );
+		for( auto const id : data ) {
+			if( done[id] ) {
+				continue;
+			}
+			done[id] = 1;
+
+			auto const str = pool[id];
+			result[id] = pool.intern( str.substr( 0, str.find_last_of( '\\' ) ) );
+		}
+
+		return result;
+	}
+
+	// The id of the folder containing a file, or of id itself for a directory.
+	// parents are as intern_folders returns them. Directories are looked up in
+	// stats when given.
+	inline string_id folder_of(string_id id, string_pool const& pool, id_list const& parents, stat_cache* stats = nullptr)
+	{
+		auto const str = pool[id];
+		if( stats ? stats->get( str ).is_directory : is_directory( str ) ) {
+			return id;
+		}
+
+		return parents[id];
+	}
+
+	// Folder ids of a list in order, keeping only the first of those naming the
+	// same folder when dedup is set. Empty once cancel is set.
+	inline id_list folders_of(
+		id_list const& ids, string_pool const& pool, id_list const& parents, bool dedup, stat_cache* stats = nullptr,
+		cancel_token const* cancel = nullptr
+	) {
+		if( stats ) {
+			std::vector< boost::string_ref > paths;
+			paths.reserve( ids.size() );
+			for( auto const id : ids ) {
+				paths.push_back( pool[id] );
+			}
+			stats->prefetch( paths, cancel );
+		}
+
+		id_list result;
+		result.reserve( ids.size() );
+
+		// Without a cache each path is stat'ed here, so the token is polled
+		// between batches of them.
+		std::size_t const batch = 1024;
+		path_identities seen;
+		for( std::size_t i = 0; i < ids.size(); ++i ) {
+			if( i % batch == 0 && is_cancelled( cancel ) ) {
+				return {};
+			}
+
+			auto const id = ids[i];
+			auto const folder = folder_of( id, pool, parents, stats );
+			if( !dedup || seen.add( pool[folder] ) ) {
+				result.push_back( folder );
+			}
+		}
+
+		return result;
+	}
+
+	// Filter, sort and deduplicate as the result list shows them. Deduplication
+	// keeps the first path of data naming each file, compared as aliases does;
+	// sort_order::input keeps that first-seen order. Folder-only results are always
+	// sorted by path. keys and aliases must cover every id in data. Folder-only
+	// mode stats every path, through stats when given, and interns its folders.
+	inline id_list run_query(
+		id_list const& data, string_pool& pool, sort_keys const& keys, path_aliases const& aliases,
+		query_options const& opts, stat_cache* stats = nullptr
+	) {
+		bool const dedup = !opts.duplication;
+
+		id_list buf;
+		std::size_t filtered = 0;
+		{
+			stage_timer timer( stat_stage::filter );
+			std::vector< char > seen( dedup ? pool.size() : 0, 0 );
+			for( auto const id : data ) {
+				if( !opts.folder_only && !has_extension( pool[id], opts.extensions ) ) {
+					continue;
+				}
+				if( dedup ) {
+					if( seen[id] || !aliases.is_first( id ) ) {
+						continue;
+					}
+					seen[id] = 1;
+				}
+				buf.push_back( id );
+			}
+
+			// Counted in a pass of its own, so that the one above costs nothing
+			// more without stats.
+			if( timer.active() && !opts.folder_only ) {
+				for( auto const id : data ) {
+					filtered += has_extension( pool[id], opts.extensions ) ? 0 : 1;
+				}
+			}
+		}
+
+		if( opts.folder_only ) {
+			stage_timer timer( stat_stage::folders );
+			buf = folders_of( buf, pool, intern_folders( buf, pool ), dedup, stats );
+		}
+
+		stage_timer timer( stat_stage::sort );
+
+		// Folders may be new strings without keys.
+		if( opts.folder_only ) {
+			boost::sort( buf, [&pool](string_id lhs, string_id rhs) {
+				return pool[lhs] < pool[rhs];
+			} );
+		}
+		else if( opts.order == sort_order::extension ) {
+			keys.sort_by_extension( buf );
+		}
+		else if( opts.order == sort_order::path ) {
+			keys.sort_by_path( buf );
+		}
+
+		// Whatever was neither filtered out nor kept was a duplicate.
+		count_stat( stat_counter::filtered_out, filtered );
+		count_stat( stat_counter::duplicates_removed, data.size() - filtered - buf.size() );
+
+		return buf;
+	}
+
+	// The first n ids of run_query( data, pool, ... opts ) for data that has no
+	// keys or aliases yet: only the n smallest are sorted, so a result can be
+	// shown before it is indexed. Not for folder-only results.
+	inline id_list first_rows(id_list const& data, string_pool const& pool, query_options const& opts, std::size_t n)
+	{
+		bool const dedup = !opts.duplication;
+
+		id_list buf;
+		std::vector< char > seen( dedup ? pool.size() : 0, 0 );
+		path_identities files;
+		for( auto const id : data ) {
+			if( opts.order == sort_order::input && buf.size() == n ) {
+				break;
+			}
+			if( !has_extension( pool[id], opts.extensions ) ) {
+				continue;
+			}
+			if( dedup ) {
+				if( seen[id] ) {
+					continue;
+				}
+				seen[id] = 1;
+				if( !files.add( pool[id] ) ) {
+					continue;
+				}
+			}
+			buf.push_back( id );
+		}
+
+		auto const mid = buf.begin() + std::min( n, buf.size() );
+		if( opts.order == sort_order::extension ) {
+			std::partial_sort( buf.begin(), mid, buf.end(), [&pool](string_id lhs, string_id rhs) {
+				auto const l = extension_of( pool[lhs] );
+				auto const r = extension_of( pool[rhs] );
+				if( boost::lexicographical_compare( l, r ) ) {
+					return true;
+				}
+				if( boost::lexicographical_compare( r, l ) ) {
+					return false;
+				}
+				return pool[lhs] < pool[rhs];
+			} );
+		}
+		else if( opts.order == sort_order::path ) {
+			std::partial_sort( buf.begin(), mid, buf.end(), [&pool](string_id lhs, string_id rhs) {
+				return pool[lhs] < pool[rhs];
+			} );
+		}
+		buf.erase( mid, buf.end() );
+
+		return buf;
+	}
+
+} // namespace pmm_lookupper
+
+#endif // PMM_LOOKUPPER_QUERY_HPP_
@@ -0,0 +1,300 @@
+#ifndef PMM_LOOKUPPER_QUERY_ENGINE_HPP_
+#define PMM_LOOKUPPER_QUERY_ENGINE_HPP_
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#include <boost/optional.hpp>
+#include "cancel_token.hpp"
+#include "engine.hpp"
+#include "filter_engine.hpp"
+#include "path_sources.hpp"
+#include "query.hpp"
+#include "scan_cache.hpp"
+#include "stat_cache.hpp"
+#include "string_pool.hpp"
+#include "thread_pool.hpp"
+
+namespace pmm_lookupper {
+
+	enum class query_stage
+	{
+		scan,
+		index,
+		query
+	};
+
+	// Every notification carries the generation of the latest request when its
+	// work started; anything older than the caller's latest request is stale.
+	struct query_progress
+	{
+		std::uint64_t generation;
+		query_stage stage;
+		std::size_t done;
+		std::size_t total;
+	};
+
+	struct load_report
+	{
+		std::uint64_t generation;
+		std::vector< std::string > errors;
+	};
+
+	// A partial result holds the first rows of the complete one. sources are the
+	// paths of the load the rows were taken from.
+	struct query_result
+	{
+		std::uint64_t generation;
+		std::shared_ptr< string_pool const > strings;
+		std::shared_ptr< path_sources const > sources;
+		id_list rows;
+		bool complete;
+	};
+
+	// Called from the engine's thread or from pool workers, one call at a time.
+	struct query_listener
+	{
+		std::function< void(query_progress const&) > progress;
+		std::function< void(load_report) > loaded;
+		std::function< void(query_result) > result;
+	};
+
+	// Loads, indexes and queries on a thread of its own. Only the latest request
+	// of each kind is kept: a load cancels the running load and query, a query
+	// cancels the running query and runs once the data is loaded. A finished load
+	// reruns the latest query.
+	class query_engine
+	{
+		thread_pool& pool_;
+		query_listener listener_;
+		stat_cache* stats_;
+		scan_cache* cache_;
+		std::size_t partial_rows_;
+
+		std::mutex mtx_;
+		std::condition_variable cv_;
+		std::condition_variable idle_cv_;
+		boost::optional< std::vector< std::string > > files_;
+		boost::optional< query_options > opts_;
+		boost::optional< query_options > last_opts_;
+		cancel_token load_cancel_;
+		cancel_token query_cancel_;
+		std::uint64_t generation_;
+		bool busy_;
+		bool stop_;
+
+		// Owned by the worker.
+		std::unique_ptr< filter_engine > filter_;
+		std::shared_ptr< path_sources const > sources_;
+		std::thread worker_;
+
+	public:
+		query_engine(
+			thread_pool& pool, query_listener listener, stat_cache* stats = nullptr, scan_cache* cache = nullptr,
+			std::size_t partial_rows = 1000
+		) :
+			pool_( pool ), listener_( std::move( listener ) ), stats_( stats ), cache_( cache ),
+			partial_rows_( partial_rows ), generation_( 0 ), busy_( false ), stop_( false )
+		{
+			worker_ = std::thread( [this] { run(); } );
+		}
+
+		query_engine(query_engine const&) = delete;
+		query_engine& operator=(query_engine const&) = delete;
+
+		~query_engine()
+		{
+			{
+				std::lock_guard< std::mutex > lock( mtx_ );
+				load_cancel_.cancel();
+				query_cancel_.cancel();
+				stop_ = true;
+			}
+			cv_.notify_all();
+			worker_.join();
+		}
+
+		// Returns the generation of the request.
+		std::uint64_t load(std::vector< std::string > files)
+		{
+			std::lock_guard< std::mutex > lock( mtx_ );
+			load_cancel_.cancel();
+			query_cancel_.cancel();
+			load_cancel_ = cancel_token();
+			query_cancel_ = cancel_token();
+			files_ = std::move( files );
+			cv_.notify_all();
+
+			return ++generation_;
+		}
+
+		std::uint64_t query(query_options const& opts)
+		{
+			std::lock_guard< std::mutex > lock( mtx_ );
+			query_cancel_.cancel();
+			query_cancel_ = cancel_token();
+			opts_ = opts;
+			last_opts_ = opts;
+			cv_.notify_all();
+
+			return ++generation_;
+		}
+
+		// Drops pending requests and stops the running ones.
+		void cancel()
+		{
+			std::lock_guard< std::mutex > lock( mtx_ );
+			load_cancel_.cancel();
+			query_cancel_.cancel();
+			files_ = boost::none;
+			opts_ = boost::none;
+		}
+
+		// Blocks until every request made so far has finished.
+		void wait()
+		{
+			std::unique_lock< std::mutex > lock( mtx_ );
+			idle_cv_.wait( lock, [this] {
+				return !busy_ && !files_ && !opts_;
+			} );
+		}
+
+	private:
+		void run()
+		{
+			std::unique_lock< std::mutex > lock( mtx_ );
+			for(;;) {
+				cv_.wait( lock, [this] {
+					return stop_ || files_ || opts_;
+				} );
+				if( stop_ ) {
+					return;
+				}
+
+				busy_ = true;
+				if( files_ ) {
+					auto files = std::move( *files_ );
+					files_ = boost::none;
+					auto const cancel = load_cancel_;
+					lock.unlock();
+					run_load( files, cancel );
+				}
+				else {
+					auto const opts = *opts_;
+					opts_ = boost::none;
+					auto const cancel = query_cancel_;
+					auto const generation = generation_;
+					lock.unlock();
+					run_query( opts, cancel, generation );
+				}
+				lock.lock();
+				busy_ = false;
+				idle_cv_.notify_all();
+			}
+		}
+
+		inline std::uint64_t generation()
+		{
+			std::lock_guard< std::mutex > lock( mtx_ );
+			return generation_;
+		}
+
+		void notify(query_stage stage, std::size_t done, std::size_t total)
+		{
+			if( listener_.progress ) {
+				listener_.progress( query_progress{ generation(), stage, done, total } );
+			}
+		}
+
+		void run_load(std::vector< std::string > const& files, cancel_token const& cancel)
+		{
+			// Workers report in any order; progress is passed on about a hundred
+			// times per load, one call at a time and never going back.
+			std::mutex progress_mtx;
+			std::size_t next = 0;
+			load_monitor monitor;
+			monitor.cancel = cancel;
+			monitor.progress = [this, &progress_mtx, &next](std::size_t done, std::size_t total) {
+				std::lock_guard< std::mutex > lock( progress_mtx );
+				if( done >= next ) {
+					next = done + total / 100 + 1;
+					notify( query_stage::scan, done, total );
+				}
+			};
+
+			notify( query_stage::scan, 0, 0 );
+			auto const projects = crawl_projects( files, pool_, cache_, &monitor );
+			if( cancel.cancelled() ) {
+				return;
+			}
+			if( cache_ ) {
+				cache_->save();
+			}
+			if( listener_.loaded ) {
+				listener_.loaded( load_report{ generation(), load_errors( projects ) } );
+			}
+
+			auto strings = std::make_shared< string_pool >();
+			std::shared_ptr< path_sources const > sources = std::make_shared< path_sources >( intern_projects( projects, *strings ) );
+			auto const& ids = sources->ids;
+			// Nothing is added to strings once it has been handed out.
+			auto parents = intern_folders( ids, *strings );
+
+			// The first rows of the pending query, before the index is built.
+			boost::optional< query_options > opts;
+			std::uint64_t generation;
+			{
+				std::lock_guard< std::mutex > lock( mtx_ );
+				opts = opts_ ? opts_ : last_opts_;
+				generation = generation_;
+			}
+			if( opts && !opts->folder_only && listener_.result ) {
+				listener_.result( query_result{ generation, strings, sources, first_rows( ids, *strings, *opts, partial_rows_ ), false } );
+			}
+
+			notify( query_stage::index, 0, 1 );
+			stage_timer timer( stat_stage::index );
+			std::unique_ptr< filter_engine > filter( new filter_engine( std::move( strings ), ids, std::move( parents ), stats_ ) );
+			timer.stop();
+			if( cancel.cancelled() ) {
+				return;
+			}
+			filter_ = std::move( filter );
+			sources_ = std::move( sources );
+			notify( query_stage::index, 1, 1 );
+
+			std::lock_guard< std::mutex > lock( mtx_ );
+			if( !opts_ && last_opts_ ) {
+				opts_ = last_opts_;
+			}
+		}
+
+		void run_query(query_options const& opts, cancel_token const& cancel, std::uint64_t generation)
+		{
+			if( !filter_ || cancel.cancelled() ) {
+				return;
+			}
+
+			notify( query_stage::query, 0, 1 );
+			auto rows = filter_->query( opts, &cancel );
+			if( cancel.cancelled() ) {
+				return;
+			}
+			notify( query_stage::query, 1, 1 );
+
+			if( listener_.result ) {
+				listener_.result( query_result{ generation, filter_->strings(), sources_, std::move( rows ), true } );
+			}
+		}
+	};
+
+} // namespace pmm_lookupper
+
+#endif // PMM_LOOKUPPER_QUERY_ENGINE_HPP_
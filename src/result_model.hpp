@@ -0,0 +1,207 @@
+#ifndef PMM_LOOKUPPER_RESULT_MODEL_HPP_
+#define PMM_LOOKUPPER_RESULT_MODEL_HPP_
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include <boost/utility/string_ref.hpp>
+#include "path_sources.hpp"
+#include "string_pool.hpp"
+
+namespace pmm_lookupper {
+
+	// UTF-8 -> UTF-16 code units, as the wide Win32 API expects, appended to dest.
+	// An invalid sequence becomes U+FFFD.
+	inline void utf8_to_utf16(boost::string_ref src, std::wstring& dest)
+	{
+		auto const n = src.size();
+		std::size_t i = 0;
+		while( i < n ) {
+			auto const c = static_cast< unsigned char >( src[i] );
+			if( c < 0x80 ) {
+				dest += static_cast< wchar_t >( c );
+				++i;
+				continue;
+			}
+
+			std::size_t len = c >= 0xf0 ? 4 : c >= 0xe0 ? 3 : c >= 0xc0 ? 2 : 0;
+			std::uint32_t u = len == 4 ? c & 0x07 : len == 3 ? c & 0x0f : c & 0x1f;
+			for( std::size_t k = 1; k < len; ++k ) {
+				auto const t = i + k < n ? static_cast< unsigned char >( src[i + k] ) : 0;
+				if( ( t & 0xc0 ) != 0x80 ) {
+					len = 0;
+					break;
+				}
+				u = ( u << 6 ) | ( t & 0x3f );
+			}
+			if( len == 0 || u > 0x10ffff ) {
+				dest += static_cast< wchar_t >( 0xfffd );
+				++i;
+				continue;
+			}
+			i += len;
+
+			if( u >= 0x10000 ) {
+				u -= 0x10000;
+				dest += static_cast< wchar_t >( 0xd800 + ( u >> 10 ) );
+				dest += static_cast< wchar_t >( 0xdc00 + ( u & 0x3ff ) );
+			}
+			else {
+				dest += static_cast< wchar_t >( u );
+			}
+		}
+	}
+
+	// The rows of a result, served by index. Only a window of rows, the ones a
+	// view shows, is converted to wide strings, so a result of any size costs
+	// one id per row.
+	class result_model
+	{
+		std::shared_ptr< string_pool const > strings_;
+		std::shared_ptr< path_sources const > sources_;
+		id_list rows_;
+		std::size_t page_;
+
+		// Converted rows [first_, first_ + offsets_.size() - 1), null-terminated
+		// and back to back in text_.
+		std::size_t first_;
+		std::wstring text_;
+		std::vector< std::size_t > offsets_;
+
+	public:
+		explicit result_model(std::size_t page = 128) :
+			strings_( std::make_shared< string_pool >() ), page_( page ), first_( 0 ), offsets_( 1, 0 )
+		{ }
+
+		// Rows are ids into strings, which is kept alive by the model, as are the
+		// sources of the load the rows come from when given.
+		void reset(std::shared_ptr< string_pool const > strings, id_list rows, std::shared_ptr< path_sources const > sources = nullptr)
+		{
+			strings_ = std::move( strings );
+			sources_ = std::move( sources );
+			rows_ = std::move( rows );
+			invalidate();
+		}
+
+		inline std::size_t size() const noexcept
+		{
+			return rows_.size();
+		}
+
+		inline id_list const& rows() const noexcept
+		{
+			return rows_;
+		}
+
+		inline string_pool const& strings() const noexcept
+		{
+			return *strings_;
+		}
+
+		// nullptr when the rows came without sources.
+		inline path_sources const* sources() const noexcept
+		{
+			return sources_.get();
+		}
+
+		inline boost::string_ref path(std::size_t row) const noexcept
+		{
+			return ( *strings_ )[rows_[row]];
+		}
+
+		// Converts rows [first, last], clamped to the result, ahead of wide().
+		void prepare(std::size_t first, std::size_t last)
+		{
+			if( rows_.empty() ) {
+				return;
+			}
+			if( last >= rows_.size() ) {
+				last = rows_.size() - 1;
+			}
+			if( first > last || ( first >= first_ && last < first_ + cached() ) ) {
+				return;
+			}
+
+			invalidate();
+			first_ = first;
+			for( auto i = first; i <= last; ++i ) {
+				utf8_to_utf16( path( i ), text_ );
+				text_ += L'\0';
+				offsets_.push_back( text_.size() );
+			}
+		}
+
+		// The wide form of a row, valid until the next call to prepare(), wide()
+		// or reset(). A row outside the window moves the window to a page from it.
+		wchar_t const* wide(std::size_t row)
+		{
+			if( row < first_ || row >= first_ + cached() ) {
+				prepare( row, row + page_ - 1 );
+			}
+
+			return text_.data() + offsets_[row - first_];
+		}
+
+		// The first row from start on whose path begins with text, or is text when
+		// partial is not set, ignoring ASCII case as the type-ahead search of a list
+		// does. The rows before start are tried last when wrap is set. size() when
+		// none matches.
+		std::size_t find(boost::string_ref text, std::size_t start, bool partial, bool wrap) const
+		{
+			auto const fold = [](char c) {
+				return c >= 'A' && c <= 'Z' ? static_cast< char >( c - 'A' + 'a' ) : c;
+			};
+			auto const matches = [&](std::size_t row) {
+				auto const p = path( row );
+				return ( partial ? p.size() >= text.size() : p.size() == text.size() )
+					&& std::equal( text.begin(), text.end(), p.begin(), [&](char a, char b) { return fold( a ) == fold( b ); } );
+			};
+
+			auto const n = rows_.size();
+			start = std::min( start, n );
+			for( auto i = start; i < n; ++i ) {
+				if( matches( i ) ) {
+					return i;
+				}
+			}
+			for( std::size_t i = 0; wrap && i < start; ++i ) {
+				if( matches( i ) ) {
+					return i;
+				}
+			}
+
+			return n;
+		}
+
+		// f( row, path ) for rows [first, last), clamped to the result.
+		template <class F>
+		void for_each(std::size_t first, std::size_t last, F f) const
+		{
+			if( last > rows_.size() ) {
+				last = rows_.size();
+			}
+			for( auto i = first; i < last; ++i ) {
+				f( i, path( i ) );
+			}
+		}
+
+	private:
+		inline std::size_t cached() const noexcept
+		{
+			return offsets_.size() - 1;
+		}
+
+		void invalidate() noexcept
+		{
+			first_ = 0;
+			text_.clear();
+			offsets_.assign( 1, 0 );
+		}
+	};
+
+} // namespace pmm_lookupper
+
+#endif // PMM_LOOKUPPER_RESULT_MODEL_HPP_
@@ -5,6 +5,8 @@
 #include "event_handler.hpp"
 #include "window_table.hpp"
 #include "procedure.hpp"
+#include "result_model.hpp"
+#include "string_pool.hpp"
 
 namespace pmm_lookupper {
 
@@ -21,7 +23,7 @@ namespace pmm_lookupper {
 		HWND parent_;
 		HWND wnd_;
 		event_handler_type eh_;
-		std::vector< std::string > data_;
+		result_model model_;
 
 		result_view(HWND parent, UINT id) :
 			parent_( parent ),
@@ -33,7 +35,7 @@ namespace pmm_lookupper {
 
 				SendMessageW( 
 					wnd_, LVM_SETEXTENDEDLISTVIEWSTYLE, 0, 
-					LVS_EX_FULLROWSELECT
+					LVS_EX_FULLROWSELECT | LVS_EX_DOUBLEBUFFER
 				);
 
 				insert_column( 0, "ファイルパス", static_cast< int >( ( rc.right - rc.left ) * 0.97f ) );
@@ -50,28 +52,76 @@ namespace pmm_lookupper {
 			return ListView_GetItemCount( wnd_ );
 		}
 		
-		void clear() noexcept
+		void clear()
 		{
-			SendMessageW( wnd_, LVM_DELETEALLITEMS, 0, 0 );
+			update( std::make_shared< string_pool >(), {} );
 		}
 
-		void update(std::vector< std::string > const& src)
+		// Rows are ids into strings, which is kept alive by the view. The control
+		// is an owner-data list, so only the row count is handed to it.
+		void update(std::shared_ptr< string_pool const > strings, id_list ids, std::shared_ptr< path_sources const > sources = nullptr)
 		{
-			clear();
-			for( auto const& p : src ) {
-				push_back( p );
-			}
+			LVITEMW item = { 0 };
+			item.stateMask = LVIS_SELECTED;
+			SendMessageW( wnd_, LVM_SETITEMSTATE, -1, reinterpret_cast< LPARAM >( &item ) );
+
+			model_.reset( std::move( strings ), std::move( ids ), std::move( sources ) );
+			SendMessageW( wnd_, LVM_SETITEMCOUNT, model_.size(), 0 );
+		}
 
-			data_ = src;
+		// WM_NOTIFY from the control, which asks for rows as it draws them.
+		void notify(NMHDR const* hdr)
+		{
+			switch( hdr->code ) {
+			case LVN_GETDISPINFOW :
+				{
+					auto& item = const_cast< LVITEMW& >( reinterpret_cast< NMLVDISPINFOW const* >( hdr )->item );
+					// Copied into the buffer of the control, which may still read it after
+					// a later row has moved the window of the model.
+					bool const text = ( item.mask & LVIF_TEXT ) && item.pszText && item.cchTextMax > 0;
+					if( text && item.iItem >= 0 && static_cast< std::size_t >( item.iItem ) < model_.size() ) {
+						lstrcpynW( item.pszText, model_.wide( item.iItem ), item.cchTextMax );
+					}
+				}
+				break;
+
+			case LVN_ODFINDITEMW :
+				{
+					// Type-ahead search, which an owner-data list leaves to its owner. The
+					// dialog returns the row through DWLP_MSGRESULT.
+					auto const find = reinterpret_cast< NMLVFINDITEMW const* >( hdr );
+					LONG_PTR row = -1;
+					if( ( find->lvfi.flags & LVFI_STRING ) && find->lvfi.psz ) {
+						auto const r = model_.find(
+							wide_to_multibyte( find->lvfi.psz, CP_UTF8 ), find->iStart > 0 ? find->iStart : 0,
+							( find->lvfi.flags & ( LVFI_PARTIAL | LVFI_SUBSTRING ) ) != 0, ( find->lvfi.flags & LVFI_WRAP ) != 0
+						);
+						if( r < model_.size() ) {
+							row = static_cast< LONG_PTR >( r );
+						}
+					}
+					SetWindowLongPtrW( parent_, DWLP_MSGRESULT, row );
+				}
+				break;
+
+			case LVN_ODCACHEHINT :
+				{
+					auto const hint = reinterpret_cast< NMLVCACHEHINT const* >( hdr );
+					if( hint->iFrom >= 0 && hint->iTo >= hint->iFrom ) {
+						model_.prepare( hint->iFrom, hint->iTo );
+					}
+				}
+				break;
+			}
 		}
 
-		std::vector< std::string > selected() const noexcept
+		std::vector< std::string > selected() const
 		{
 			std::vector< std::string > result;
 
 			int index = next_item( -1, LVNI_SELECTED );
 			while( index != -1 ) {
-				result.push_back( data_[index] );
+				result.push_back( path( index ).to_string() );
 				index = next_item( index, LVNI_SELECTED );
 			}
 
@@ -96,9 +146,19 @@ namespace pmm_lookupper {
 			SendMessageW( wnd_, LVM_SETCOLUMN, index, reinterpret_cast< LPARAM >( &col ) );
 		}
 
-		inline std::vector< std::string > const& data() const noexcept
+		inline result_model const& model() const noexcept
+		{
+			return model_;
+		}
+
+		inline std::size_t rows() const noexcept
+		{
+			return model_.size();
+		}
+
+		inline boost::string_ref path(std::size_t row) const noexcept
 		{
-			return data_;
+			return model_.path( row );
 		}
 
 		inline HWND handle() const noexcept
@@ -126,24 +186,6 @@ namespace pmm_lookupper {
 			SendMessageW( wnd_, LVM_INSERTCOLUMN, index, reinterpret_cast< LPARAM >( &col ) );
 		}
 
-		int insert(int index, boost::string_ref str) noexcept
-		{
-			std::wstring wstr( multibyte_to_wide( str, CP_UTF8 ) );
-
-			LVITEMW item = { 0 };
-			item.mask = LVIF_TEXT;
-			item.iItem = index; 
-			item.pszText = &wstr[0];
-			item.cchTextMax = wstr.size();
-
-			return static_cast< int >( SendMessageW( wnd_, LVM_INSERTITEM, 0, reinterpret_cast< LPARAM >( &item ) ) );
-		}
-
-		int push_back(boost::string_ref str) noexcept
-		{
-			return insert( size(), str );
-		}
-
 		int next_item(int index, UINT flags) const noexcept
 		{
 			return static_cast< int >( SendMessageW( 
@@ -0,0 +1,455 @@
+#ifndef PMM_LOOKUPPER_SCAN_CACHE_HPP_
+#define PMM_LOOKUPPER_SCAN_CACHE_HPP_
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <boost/optional.hpp>
+#include <boost/utility/string_ref.hpp>
+#include "filesystem.hpp"
+#include "hash.hpp"
+#include "mapped_file.hpp"
+#include "path_list.hpp"
+
+#ifdef _WIN32
+#	include "winapi.hpp"
+#else
+#	include <unistd.h>
+#endif
+
+namespace pmm_lookupper {
+
+namespace detail {
+
+	inline unsigned long current_process_id() noexcept
+	{
+#ifdef _WIN32
+		return GetCurrentProcessId();
+#else
+		return static_cast< unsigned long >( ::getpid() );
+#endif
+	}
+
+	inline std::int64_t unix_time() noexcept
+	{
+		return std::chrono::duration_cast< std::chrono::seconds >(
+			std::chrono::system_clock::now().time_since_epoch()
+		).count();
+	}
+
+	class cache_reader
+	{
+		boost::string_ref buf_;
+		std::size_t pos_;
+		bool ok_;
+
+	public:
+		explicit cache_reader(boost::string_ref buf) noexcept :
+			buf_( buf ), pos_( 0 ), ok_( true )
+		{ }
+
+		inline bool ok() const noexcept
+		{
+			return ok_;
+		}
+
+		inline bool at_end() const noexcept
+		{
+			return pos_ == buf_.size();
+		}
+
+		std::uint64_t uint(std::size_t bytes) noexcept
+		{
+			if( !ok_ || buf_.size() - pos_ < bytes ) {
+				ok_ = false;
+				return 0;
+			}
+
+			std::uint64_t v = 0;
+			for( std::size_t i = bytes; i > 0; --i ) {
+				v = ( v << 8 ) | static_cast< unsigned char >( buf_[pos_ + i - 1] );
+			}
+			pos_ += bytes;
+
+			return v;
+		}
+
+		boost::string_ref bytes(std::size_t n) noexcept
+		{
+			if( !ok_ || buf_.size() - pos_ < n ) {
+				ok_ = false;
+				return {};
+			}
+
+			auto const result = buf_.substr( pos_, n );
+			pos_ += n;
+
+			return result;
+		}
+	};
+
+	inline void put_uint(std::string& out, std::uint64_t v, std::size_t bytes)
+	{
+		for( std::size_t i = 0; i < bytes; ++i ) {
+			out += static_cast< char >( ( v >> ( i * 8 ) ) & 0xff );
+		}
+	}
+
+	inline void put_bytes(std::string& out, boost::string_ref str)
+	{
+		put_uint( out, str.size(), 4 );
+		out.append( str.begin(), str.end() );
+	}
+
+} // namespace detail
+
+	// Scan results kept on disk between runs, keyed by canonical path. A file whose
+	// size and modification time match its entry is answered without being read; a
+	// changed file whose content hash matches some entry, e.g. a copied project,
+	// reuses that entry's paths without being parsed.
+	//
+	// Several processes may share one cache file. save() merges with what is on
+	// disk and swaps the new file in by rename, so a reader never sees a partial
+	// write. Saves within a process take turns; a save that finds its entries
+	// overwritten by another process merges again.
+	//
+	// The header carries version, and a file of any other version reads as empty,
+	// so results of older parsers are never served.
+	class scan_cache
+	{
+	public:
+		struct entry
+		{
+			std::uint64_t size;
+			std::int64_t mtime;
+			std::uint64_t hash;
+			std::int64_t used;
+			bool ok;
+			path_list paths;
+		};
+
+		using entry_map = std::unordered_map< std::string, entry >;
+
+		// Entries not used for this long are dropped on save.
+		static std::int64_t const max_age = 90 * 24 * 60 * 60;
+
+		// Bump with any change to the file layout or to what the PMM and EMM
+		// parsers return.
+		static std::uint16_t const version = 2;
+
+	private:
+		std::string file_;
+		std::mutex mtx_;
+		entry_map entries_;
+		std::unordered_map< std::uint64_t, std::string > by_hash_;
+		std::unordered_set< std::string > touched_;
+		std::unordered_set< std::string > removed_;
+
+	public:
+		explicit scan_cache(std::string file) :
+			file_( std::move( file ) )
+		{
+			load( file_, entries_ );
+			index();
+		}
+
+		scan_cache(scan_cache const&) = delete;
+		scan_cache& operator=(scan_cache const&) = delete;
+
+		inline std::string const& file() const noexcept
+		{
+			return file_;
+		}
+
+		std::size_t size()
+		{
+			std::lock_guard< std::mutex > lock( mtx_ );
+			return entries_.size();
+		}
+
+		// Looks up a file by identity without reading it. Returns false when there is
+		// no entry whose size and modification time match st.
+		bool find(boost::string_ref path, file_status const& st, boost::optional< path_list >& result)
+		{
+			auto const key = canonical_path( path );
+
+			std::lock_guard< std::mutex > lock( mtx_ );
+			auto const itr = entries_.find( key );
+			if( itr == entries_.end() || itr->second.size != st.size || itr->second.mtime != st.mtime ) {
+				return false;
+			}
+
+			itr->second.used = detail::unix_time();
+			touched_.insert( key );
+			result = result_of( itr->second );
+
+			return true;
+		}
+
+		// Looks up any file with the given contents.
+		bool find_content(std::uint64_t size, std::uint64_t hash, boost::optional< path_list >& result)
+		{
+			std::lock_guard< std::mutex > lock( mtx_ );
+			auto const h = by_hash_.find( hash );
+			if( h == by_hash_.end() ) {
+				return false;
+			}
+
+			auto const itr = entries_.find( h->second );
+			if( itr == entries_.end() || itr->second.hash != hash || itr->second.size != size ) {
+				return false;
+			}
+
+			result = result_of( itr->second );
+
+			return true;
+		}
+
+		void store(boost::string_ref path, file_status const& st, std::uint64_t hash, boost::optional< path_list > const& result)
+		{
+			auto key = canonical_path( path );
+			entry e = { st.size, st.mtime, hash, detail::unix_time(), static_cast< bool >( result ), {} };
+			if( result ) {
+				e.paths = *result;
+			}
+
+			std::lock_guard< std::mutex > lock( mtx_ );
+			by_hash_[hash] = key;
+			touched_.insert( key );
+			removed_.erase( key );
+			entries_[std::move( key )] = std::move( e );
+		}
+
+		void forget(boost::string_ref path)
+		{
+			auto const key = canonical_path( path );
+
+			std::lock_guard< std::mutex > lock( mtx_ );
+			if( entries_.erase( key ) ) {
+				removed_.insert( key );
+			}
+		}
+
+		// Paths of the file at path as parse( contents ) would return them, from the
+		// cache when possible. Unreadable files are not cached.
+		template <class F>
+		boost::optional< path_list > scan(boost::string_ref path, F parse)
+		{
+			auto st = get_file_status( path );
+			if( !st.exists || st.is_directory ) {
+				forget( path );
+				return boost::none;
+			}
+
+			boost::optional< path_list > result;
+			if( find( path, st, result ) ) {
+				return result;
+			}
+
+			auto const file = map_file( path );
+			if( !file ) {
+				return boost::none;
+			}
+
+			st.size = file.size();
+			auto const hash = hash_content( file.range() );
+			if( !find_content( st.size, hash, result ) ) {
+				result = parse( file.range() );
+			}
+			store( path, st, hash, result );
+
+			return result;
+		}
+
+		// Writes the entries used or refreshed by this run, merged with the current
+		// contents of the file. Returns false when the file could not be replaced.
+		bool save()
+		{
+			std::lock_guard< std::mutex > lock( mtx_ );
+			if( touched_.empty() && removed_.empty() ) {
+				return true;
+			}
+
+			std::lock_guard< std::mutex > save_lock( save_mutex() );
+			entry_map merged;
+			for( int attempt = 0; attempt < 3; ++attempt ) {
+				merged.clear();
+				load( file_, merged );
+				merge( merged );
+				if( !write( merged ) ) {
+					return false;
+				}
+
+				// Another process may have replaced the file in between.
+				entry_map written;
+				load( file_, written );
+				if( contains( written ) ) {
+					break;
+				}
+			}
+
+			entries_ = std::move( merged );
+			index();
+			touched_.clear();
+			removed_.clear();
+
+			return true;
+		}
+
+	private:
+		static std::string const& magic()
+		{
+			static std::string const m = [] {
+				std::string m( "PMMLSC" );
+				detail::put_uint( m, version, 2 );
+				return m;
+			}();
+
+			return m;
+		}
+
+		static std::mutex& save_mutex() noexcept
+		{
+			static std::mutex m;
+			return m;
+		}
+
+		void merge(entry_map& merged) const
+		{
+			for( auto const& key : removed_ ) {
+				merged.erase( key );
+			}
+			for( auto const& key : touched_ ) {
+				auto const itr = entries_.find( key );
+				if( itr != entries_.end() ) {
+					merged[key] = itr->second;
+				}
+			}
+		}
+
+		// Whether entries has what this run stored and none of what it removed.
+		bool contains(entry_map const& entries) const
+		{
+			for( auto const& key : removed_ ) {
+				if( entries.count( key ) ) {
+					return false;
+				}
+			}
+			for( auto const& key : touched_ ) {
+				auto const mine = entries_.find( key );
+				auto const theirs = entries.find( key );
+				if( mine != entries_.end() && ( theirs == entries.end() || theirs->second.hash != mine->second.hash ) ) {
+					return false;
+				}
+			}
+
+			return true;
+		}
+
+		bool write(entry_map const& entries) const
+		{
+			static std::atomic< unsigned > serial( 0 );
+			auto const tmp = file_ + ".tmp" + std::to_string( detail::current_process_id() ) + "_" + std::to_string( serial++ );
+			{
+				std::ofstream ofs( native_file_path( tmp ), std::ios::binary | std::ios::trunc );
+				auto const bytes = serialize( entries );
+				ofs.write( bytes.data(), bytes.size() );
+				ofs.close();
+				if( ofs.fail() ) {
+					remove_file( tmp );
+					return false;
+				}
+			}
+			if( !replace_file( tmp, file_ ) ) {
+				remove_file( tmp );
+				return false;
+			}
+
+			return true;
+		}
+
+		static boost::optional< path_list > result_of(entry const& e)
+		{
+			if( !e.ok ) {
+				return boost::none;
+			}
+
+			return e.paths;
+		}
+
+		// A missing, foreign or damaged file reads as an empty cache.
+		static void load(std::string const& file, entry_map& entries)
+		{
+			auto const f = map_file( file );
+			detail::cache_reader r( f.range() );
+			if( r.bytes( magic().size() ) != magic() ) {
+				return;
+			}
+
+			auto const expiry = detail::unix_time() - max_age;
+			entry_map result;
+			auto const count = r.uint( 8 );
+			for( std::uint64_t i = 0; i < count && r.ok(); ++i ) {
+				auto const key = r.bytes( r.uint( 4 ) );
+				entry e;
+				e.size = r.uint( 8 );
+				e.mtime = static_cast< std::int64_t >( r.uint( 8 ) );
+				e.hash = r.uint( 8 );
+				e.used = static_cast< std::int64_t >( r.uint( 8 ) );
+				e.ok = r.uint( 1 ) != 0;
+				auto const n = r.uint( 4 );
+				for( std::uint64_t j = 0; j < n && r.ok(); ++j ) {
+					e.paths.push_back( r.bytes( r.uint( 4 ) ) );
+				}
+
+				if( r.ok() && e.used >= expiry ) {
+					result[key.to_string()] = std::move( e );
+				}
+			}
+
+			if( r.ok() && r.at_end() ) {
+				entries = std::move( result );
+			}
+		}
+
+		static std::string serialize(entry_map const& entries)
+		{
+			std::string out( magic().begin(), magic().end() );
+			detail::put_uint( out, entries.size(), 8 );
+
+			for( auto const& kv : entries ) {
+				auto const& e = kv.second;
+				detail::put_bytes( out, kv.first );
+				detail::put_uint( out, e.size, 8 );
+				detail::put_uint( out, static_cast< std::uint64_t >( e.mtime ), 8 );
+				detail::put_uint( out, e.hash, 8 );
+				detail::put_uint( out, static_cast< std::uint64_t >( e.used ), 8 );
+				detail::put_uint( out, e.ok ? 1 : 0, 1 );
+				detail::put_uint( out, e.paths.size(), 4 );
+				for( std::size_t i = 0; i < e.paths.size(); ++i ) {
+					detail::put_bytes( out, e.paths[i] );
+				}
+			}
+
+			return out;
+		}
+
+		void index()
+		{
+			by_hash_.clear();
+			for( auto const& kv : entries_ ) {
+				by_hash_[kv.second.hash] = kv.first;
+			}
+		}
+	};
+
+} // namespace pmm_lookupper
+
+#endif // PMM_LOOKUPPER_SCAN_CACHE_HPP_
@@ -0,0 +1,286 @@
+#ifndef PMM_LOOKUPPER_SCANNER_HPP_
+#define PMM_LOOKUPPER_SCANNER_HPP_
+
+#include <algorithm>
+#include <iterator>
+#include <cstddef>
+#include <cstdint>
+#include <istream>
+#include <string>
+#include <vector>
+#include <boost/utility/string_ref.hpp>
+
+#if defined( __AVX2__ )
+#	include <immintrin.h>
+#	define PMM_LOOKUPPER_SCANNER_AVX2
+#elif defined( __SSE2__ )
+#	include <emmintrin.h>
+#	define PMM_LOOKUPPER_SCANNER_SSE2
+#endif
+
+namespace pmm_lookupper {
+
+	template <class Iterator>
+	inline bool drive_letter_exists(Iterator itr, Iterator end)
+	{
+		boost::string_ref const str( ":\\" );
+
+		if( std::distance( itr, end ) < static_cast< std::ptrdiff_t >( str.size() + 1 ) ) {
+			return false;
+		}
+
+		for( int i = 'A'; i <= 'Z'; ++i ) {
+			if( *itr == i ) {
+				return std::equal( str.begin(), str.end(), itr + 1 );
+			}
+		}
+
+		return false;
+	}
+
+namespace detail {
+
+	inline bool is_sjis_lead_byte(char c) noexcept
+	{
+		auto const u = static_cast< unsigned char >( c );
+		return ( u >= 0x81 && u <= 0x9f ) || ( u >= 0xe0 && u <= 0xfc );
+	}
+
+	// A byte that is not a lead byte always ends a character, so p is a trail byte
+	// exactly when it is preceded by an odd run of lead bytes.
+	inline bool is_sjis_trail_byte(char const* origin, char const* p) noexcept
+	{
+		std::size_t n = 0;
+		while( p != origin && is_sjis_lead_byte( *--p ) ) {
+			++n;
+		}
+
+		return n % 2 == 1;
+	}
+
+	inline bool is_drive_letter(char c) noexcept
+	{
+		return static_cast< unsigned char >( c - 'A' ) < 26;
+	}
+
+	inline bool is_drive_candidate(char const* origin, char const* colon) noexcept
+	{
+		return is_drive_letter( colon[-1] ) && !is_sjis_trail_byte( origin, colon - 1 );
+	}
+
+	inline char const* find_drive_letter_scalar(char const* origin, char const* first, char const* last) noexcept
+	{
+		for( auto p = first; p + 1 < last; ++p ) {
+			if( p[0] == ':' && p[1] == '\\' && is_drive_candidate( origin, p ) ) {
+				return p - 1;
+			}
+		}
+
+		return nullptr;
+	}
+
+} // namespace detail
+
+	// Returns the drive letter of the first "X:\" in [first, last) or last.
+	// origin is the start of the buffer and bounds the Shift-JIS resynchronization.
+	inline char const* find_drive_letter(char const* origin, char const* first, char const* last) noexcept
+	{
+		if( last - first < 3 ) {
+			return last;
+		}
+
+		auto p = first + 1;
+
+#if defined( PMM_LOOKUPPER_SCANNER_AVX2 )
+		__m256i const colon = _mm256_set1_epi8( ':' );
+		__m256i const backslash = _mm256_set1_epi8( '\\' );
+
+		for( ; p + 32 < last; p += 32 ) {
+			__m256i const a = _mm256_loadu_si256( reinterpret_cast< __m256i const* >( p ) );
+			__m256i const b = _mm256_loadu_si256( reinterpret_cast< __m256i const* >( p + 1 ) );
+			auto mask = static_cast< std::uint32_t >( _mm256_movemask_epi8(
+				_mm256_and_si256( _mm256_cmpeq_epi8( a, colon ), _mm256_cmpeq_epi8( b, backslash ) )
+			) );
+
+			while( mask ) {
+				auto const c = p + __builtin_ctz( mask );
+				if( detail::is_drive_candidate( origin, c ) ) {
+					return c - 1;
+				}
+				mask &= mask - 1;
+			}
+		}
+#elif defined( PMM_LOOKUPPER_SCANNER_SSE2 )
+		__m128i const colon = _mm_set1_epi8( ':' );
+		__m128i const backslash = _mm_set1_epi8( '\\' );
+
+		for( ; p + 16 < last; p += 16 ) {
+			__m128i const a = _mm_loadu_si128( reinterpret_cast< __m128i const* >( p ) );
+			__m128i const b = _mm_loadu_si128( reinterpret_cast< __m128i const* >( p + 1 ) );
+			auto mask = static_cast< std::uint32_t >( _mm_movemask_epi8(
+				_mm_and_si128( _mm_cmpeq_epi8( a, colon ), _mm_cmpeq_epi8( b, backslash ) )
+			) );
+
+			while( mask ) {
+				auto const c = p + __builtin_ctz( mask );
+				if( detail::is_drive_candidate( origin, c ) ) {
+					return c - 1;
+				}
+				mask &= mask - 1;
+			}
+		}
+#endif
+
+		auto const result = detail::find_drive_letter_scalar( origin, p, last );
+		return result ? result : last;
+	}
+
+	// Calls f with every "X:\..." run in buf up to (not including) the end character.
+	template <class F>
+	inline void for_each_file_path(boost::string_ref buf, char end, F f)
+	{
+		char const* const origin = buf.data();
+		char const* const last = buf.data() + buf.size();
+
+		auto itr = find_drive_letter( origin, origin, last );
+		while( itr != last ) {
+			auto const term = std::find( itr, last, end );
+			f( boost::string_ref( itr, term - itr ) );
+
+			if( term == last ) {
+				break;
+			}
+			itr = find_drive_letter( origin, term + 1, last );
+		}
+	}
+
+	struct path_span
+	{
+		std::size_t offset;
+		std::size_t length;
+	};
+
+	inline boost::string_ref span_ref(boost::string_ref buf, path_span const& s) noexcept
+	{
+		return buf.substr( s.offset, s.length );
+	}
+
+	inline std::vector< path_span > find_path_spans(boost::string_ref buf, char end)
+	{
+		std::vector< path_span > result;
+
+		for_each_file_path( buf, end, [&](boost::string_ref path) {
+			result.push_back( { static_cast< std::size_t >( path.data() - buf.data() ), path.size() } );
+		} );
+
+		return result;
+	}
+
+	// Same results as for_each_file_path over the whole stream, but only a window of
+	// window_size bytes is resident. A path that crosses a window boundary is
+	// carried over in its own buffer until its end character arrives; one longer
+	// than any Windows path is dropped rather than buffered.
+	template <class F>
+	inline void for_each_file_path(std::istream& is, char end, F f, std::size_t window_size = 64 * 1024)
+	{
+		// '\0' never belongs to a double-byte character, so the window always starts
+		// at a character boundary. An odd lead byte run before the carried bytes is
+		// reproduced by one synthetic lead byte.
+		std::size_t const prefix_max = 4;
+		std::vector< char > window( prefix_max + window_size );
+		// 32767 characters of at most two bytes each.
+		std::size_t const partial_max = 64 * 1024;
+		std::string partial;
+		bool in_path = false;
+		bool overlong = false;
+
+		char carry[2];
+		std::size_t carry_size = 0;
+		bool odd_lead_run = false;
+		std::size_t skip = 0;
+
+		for( ;; ) {
+			std::size_t prefix = 0;
+			window[prefix++] = '\0';
+			if( odd_lead_run ) {
+				window[prefix++] = static_cast< char >( 0x81 );
+			}
+			std::copy( carry, carry + carry_size, window.begin() + prefix );
+			prefix += carry_size;
+
+			is.read( window.data() + prefix, window_size );
+			auto const n = static_cast< std::size_t >( is.gcount() );
+			if( n == 0 ) {
+				break;
+			}
+
+			char const* const origin = window.data();
+			char const* const last = origin + prefix + n;
+			char const* resume = origin + prefix - carry_size + skip;
+
+			if( in_path ) {
+				auto const term = std::find( origin + prefix, last, end );
+				if( !overlong && partial.size() + ( term - ( origin + prefix ) ) > partial_max ) {
+					partial.clear();
+					partial.shrink_to_fit();
+					overlong = true;
+				}
+				if( !overlong ) {
+					partial.append( origin + prefix, term );
+				}
+				if( term == last ) {
+					carry_size = 0;
+					skip = 0;
+					odd_lead_run = false;
+					continue;
+				}
+
+				if( !overlong ) {
+					f( boost::string_ref( partial ) );
+				}
+				partial.clear();
+				in_path = false;
+				overlong = false;
+				resume = term + 1;
+			}
+
+			auto itr = find_drive_letter( origin, resume, last );
+			while( itr != last ) {
+				auto const term = std::find( itr, last, end );
+				if( term == last ) {
+					overlong = static_cast< std::size_t >( last - itr ) > partial_max;
+					if( !overlong ) {
+						partial.assign( itr, last );
+					}
+					in_path = true;
+					break;
+				}
+
+				f( boost::string_ref( itr, term - itr ) );
+				resume = term + 1;
+				itr = find_drive_letter( origin, resume, last );
+			}
+
+			if( in_path ) {
+				carry_size = 0;
+				skip = 0;
+				odd_lead_run = false;
+				continue;
+			}
+
+			// Letters in the last two bytes have not been examined yet.
+			carry_size = std::min< std::size_t >( 2, last - origin - 1 );
+			auto const carry_first = last - carry_size;
+			std::copy( carry_first, last, carry );
+			skip = resume > carry_first ? resume - carry_first : 0;
+			odd_lead_run = detail::is_sjis_trail_byte( origin, carry_first );
+		}
+
+		if( in_path && !overlong ) {
+			f( boost::string_ref( partial ) );
+		}
+	}
+
+} // namespace pmm_lookupper
+
+#endif // PMM_LOOKUPPER_SCANNER_HPP_
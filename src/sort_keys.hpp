@@ -0,0 +1,167 @@
+#ifndef PMM_LOOKUPPER_SORT_KEYS_HPP_
+#define PMM_LOOKUPPER_SORT_KEYS_HPP_
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include <boost/range/algorithm.hpp>
+#include <boost/utility/string_ref.hpp>
+#include "filter.hpp"
+#include "path_list.hpp"
+#include "string_pool.hpp"
+
+namespace pmm_lookupper {
+
+	// Stable LSD radix sort of ids by key( id ), an integer below 2^64. Digits in
+	// which every key agrees are skipped.
+	template <class Key>
+	inline void radix_sort(id_list& ids, Key key)
+	{
+		struct item
+		{
+			std::uint64_t key;
+			string_id id;
+		};
+
+		auto const n = ids.size();
+		std::vector< item > a( n );
+		std::uint64_t any = 0;
+		for( std::size_t i = 0; i < n; ++i ) {
+			a[i] = { static_cast< std::uint64_t >( key( ids[i] ) ), ids[i] };
+			any |= a[i].key;
+		}
+
+		if( n < 1024 ) {
+			std::stable_sort( a.begin(), a.end(), [](item const& lhs, item const& rhs) {
+				return lhs.key < rhs.key;
+			} );
+		}
+		else {
+			std::vector< item > b( n );
+			std::vector< std::size_t > count( 1 << 16 );
+			for( unsigned shift = 0; shift < 64 && ( any >> shift ) != 0; shift += 16 ) {
+				std::fill( count.begin(), count.end(), 0 );
+				for( auto const& x : a ) {
+					++count[( x.key >> shift ) & 0xffff];
+				}
+				if( count[( a[0].key >> shift ) & 0xffff] == n ) {
+					continue;
+				}
+
+				std::size_t sum = 0;
+				for( auto& c : count ) {
+					auto const t = c;
+					c = sum;
+					sum += t;
+				}
+				for( auto const& x : a ) {
+					b[count[( x.key >> shift ) & 0xffff]++] = x;
+				}
+				a.swap( b );
+			}
+		}
+
+		for( std::size_t i = 0; i < n; ++i ) {
+			ids[i] = a[i].id;
+		}
+	}
+
+	// Ranks of the strings of a pool in path order, and of their extensions in the
+	// order of the extension sort, computed once so that sorting ids compares
+	// integers. Ids interned after construction have no keys.
+	class sort_keys
+	{
+		std::vector< std::uint32_t > path_rank_;
+		std::vector< std::uint32_t > ext_rank_;
+
+	public:
+		sort_keys() = default;
+
+		explicit sort_keys(string_pool const& pool) :
+			path_rank_( pool.size() ),
+			ext_rank_( pool.size() )
+		{
+			id_list ids( pool.size() );
+			for( std::size_t i = 0; i < ids.size(); ++i ) {
+				ids[i] = static_cast< string_id >( i );
+			}
+
+			// Strings in a pool are distinct, so ranks are unique.
+			boost::sort( ids, [&pool](string_id lhs, string_id rhs) {
+				return pool[lhs] < pool[rhs];
+			} );
+			for( std::size_t i = 0; i < ids.size(); ++i ) {
+				path_rank_[ids[i]] = static_cast< std::uint32_t >( i );
+			}
+
+			// Extensions compare as the extension sort always has, char by char
+			// with operator<, so equal text is one rank.
+			std::unordered_map< boost::string_ref, std::uint32_t, string_ref_hash > exts;
+			for( std::size_t i = 0; i < ids.size(); ++i ) {
+				exts.emplace( extension_of( pool[static_cast< string_id >( i )] ), 0 );
+			}
+
+			std::vector< boost::string_ref > sorted;
+			sorted.reserve( exts.size() );
+			for( auto const& kv : exts ) {
+				sorted.push_back( kv.first );
+			}
+			boost::sort( sorted, [](boost::string_ref lhs, boost::string_ref rhs) {
+				return boost::lexicographical_compare( lhs, rhs );
+			} );
+			for( std::size_t i = 0; i < sorted.size(); ++i ) {
+				exts[sorted[i]] = static_cast< std::uint32_t >( i );
+			}
+
+			for( std::size_t i = 0; i < ids.size(); ++i ) {
+				ext_rank_[i] = exts[extension_of( pool[static_cast< string_id >( i )] )];
+			}
+		}
+
+		inline std::size_t size() const noexcept
+		{
+			return path_rank_.size();
+		}
+
+		inline bool has(string_id id) const noexcept
+		{
+			return id < path_rank_.size();
+		}
+
+		inline std::uint32_t path_rank(string_id id) const noexcept
+		{
+			return path_rank_[id];
+		}
+
+		inline std::uint32_t extension_rank(string_id id) const noexcept
+		{
+			return ext_rank_[id];
+		}
+
+		// (extension, path) packed so that integer order is the extension sort order.
+		inline std::uint64_t extension_key(string_id id) const noexcept
+		{
+			return ( static_cast< std::uint64_t >( ext_rank_[id] ) << 32 ) | path_rank_[id];
+		}
+
+		void sort_by_path(id_list& ids) const
+		{
+			radix_sort( ids, [this](string_id id) {
+				return path_rank_[id];
+			} );
+		}
+
+		void sort_by_extension(id_list& ids) const
+		{
+			radix_sort( ids, [this](string_id id) {
+				return extension_key( id );
+			} );
+		}
+	};
+
+} // namespace pmm_lookupper
+
+#endif // PMM_LOOKUPPER_SORT_KEYS_HPP_
@@ -0,0 +1,135 @@
+#ifndef PMM_LOOKUPPER_STAT_CACHE_HPP_
+#define PMM_LOOKUPPER_STAT_CACHE_HPP_
+
+#include <chrono>
+#include <cstddef>
+#include <mutex>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include <boost/utility/string_ref.hpp>
+#include "cancel_token.hpp"
+#include "filesystem.hpp"
+#include "path_list.hpp"
+#include "string_pool.hpp"
+#include "thread_pool.hpp"
+
+namespace pmm_lookupper {
+
+	// File metadata kept for a session. Each path is stat'ed once, or again after
+	// max_age when that is not zero. prefetch() stats a batch of paths on the
+	// pool, which hides the latency of slow and network drives.
+	class stat_cache
+	{
+	public:
+		using clock = std::chrono::steady_clock;
+
+	private:
+		struct slot
+		{
+			file_status status;
+			clock::time_point time;
+		};
+
+		thread_pool& pool_;
+		clock::duration max_age_;
+		std::mutex mtx_;
+		string_pool keys_;
+		std::unordered_map< boost::string_ref, slot, string_ref_hash > entries_;
+
+	public:
+		explicit stat_cache(thread_pool& pool, clock::duration max_age = clock::duration::zero()) :
+			pool_( pool ), max_age_( max_age )
+		{ }
+
+		stat_cache(stat_cache const&) = delete;
+		stat_cache& operator=(stat_cache const&) = delete;
+
+		inline clock::duration max_age() const noexcept
+		{
+			return max_age_;
+		}
+
+		// Stats the paths that are not cached or have expired, in parallel. Must
+		// not be called from a task of the pool. Once cancel is set the remaining
+		// paths are skipped and nothing is stored.
+		template <class Range>
+		void prefetch(Range const& paths, cancel_token const* cancel = nullptr)
+		{
+			auto const now = clock::now();
+
+			std::vector< boost::string_ref > missing;
+			{
+				std::unordered_set< boost::string_ref, string_ref_hash > queued;
+				std::lock_guard< std::mutex > lock( mtx_ );
+				for( boost::string_ref const path : paths ) {
+					auto const itr = entries_.find( path );
+					if( ( itr == entries_.end() || !fresh( itr->second, now ) ) && queued.insert( path ).second ) {
+						missing.push_back( path );
+					}
+				}
+			}
+
+			std::vector< file_status > status( missing.size() );
+			parallel_for( pool_, missing.size(), [&](std::size_t i) {
+				if( !is_cancelled( cancel ) ) {
+					status[i] = get_file_status( missing[i] );
+				}
+			} );
+			if( is_cancelled( cancel ) ) {
+				return;
+			}
+
+			std::lock_guard< std::mutex > lock( mtx_ );
+			for( std::size_t i = 0; i < missing.size(); ++i ) {
+				put( missing[i], status[i], now );
+			}
+		}
+
+		file_status get(boost::string_ref path)
+		{
+			auto const now = clock::now();
+			{
+				std::lock_guard< std::mutex > lock( mtx_ );
+				auto const itr = entries_.find( path );
+				if( itr != entries_.end() && fresh( itr->second, now ) ) {
+					return itr->second.status;
+				}
+			}
+
+			auto const status = get_file_status( path );
+
+			std::lock_guard< std::mutex > lock( mtx_ );
+			put( path, status, now );
+
+			return status;
+		}
+
+		void clear()
+		{
+			std::lock_guard< std::mutex > lock( mtx_ );
+			entries_.clear();
+			keys_.clear();
+		}
+
+	private:
+		inline bool fresh(slot const& s, clock::time_point now) const noexcept
+		{
+			return max_age_ == clock::duration::zero() || now - s.time < max_age_;
+		}
+
+		void put(boost::string_ref path, file_status const& status, clock::time_point now)
+		{
+			auto const itr = entries_.find( path );
+			if( itr != entries_.end() ) {
+				itr->second = { status, now };
+				return;
+			}
+
+			entries_.emplace( keys_[keys_.intern( path )], slot{ status, now } );
+		}
+	};
+
+} // namespace pmm_lookupper
+
+#endif // PMM_LOOKUPPER_STAT_CACHE_HPP_
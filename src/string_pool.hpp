@@ -0,0 +1,95 @@
+#ifndef PMM_LOOKUPPER_STRING_POOL_HPP_
+#define PMM_LOOKUPPER_STRING_POOL_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+#include <boost/utility/string_ref.hpp>
+#include "path_list.hpp"
+
+namespace pmm_lookupper {
+
+	using string_id = std::uint32_t;
+	using id_list = std::vector< string_id >;
+
+	// Append-only arena of distinct strings, each named by a dense 32-bit id.
+	// Strings are never moved, so views stay valid until clear().
+	class string_pool
+	{
+		static std::size_t const block_size = 1 << 20;
+
+		std::vector< std::unique_ptr< char[] > > blocks_;
+		std::size_t block_used_;
+		std::size_t block_capacity_;
+		std::vector< boost::string_ref > strings_;
+		std::unordered_map< boost::string_ref, string_id, string_ref_hash > index_;
+
+	public:
+		string_pool() noexcept :
+			block_used_( 0 ), block_capacity_( 0 )
+		{ }
+
+		string_pool(string_pool const&) = delete;
+		string_pool& operator=(string_pool const&) = delete;
+
+		inline std::size_t size() const noexcept
+		{
+			return strings_.size();
+		}
+
+		inline boost::string_ref operator[](string_id id) const noexcept
+		{
+			return strings_[id];
+		}
+
+		string_id intern(boost::string_ref str)
+		{
+			auto const itr = index_.find( str );
+			if( itr != index_.end() ) {
+				return itr->second;
+			}
+
+			auto const stored = store( str );
+			auto const id = static_cast< string_id >( strings_.size() );
+			strings_.push_back( stored );
+			index_.emplace( stored, id );
+
+			return id;
+		}
+
+		void clear() noexcept
+		{
+			blocks_.clear();
+			block_used_ = 0;
+			block_capacity_ = 0;
+			strings_.clear();
+			index_.clear();
+		}
+
+	private:
+		boost::string_ref store(boost::string_ref str)
+		{
+			if( str.empty() ) {
+				return boost::string_ref();
+			}
+
+			if( block_capacity_ - block_used_ < str.size() ) {
+				block_capacity_ = str.size() > block_size ? str.size() : block_size;
+				blocks_.emplace_back( new char[block_capacity_] );
+				block_used_ = 0;
+			}
+
+			auto const p = blocks_.back().get() + block_used_;
+			std::memcpy( p, str.data(), str.size() );
+			block_used_ += str.size();
+
+			return boost::string_ref( p, str.size() );
+		}
+	};
+
+} // namespace pmm_lookupper
+
+#endif // PMM_LOOKUPPER_STRING_POOL_HPP_
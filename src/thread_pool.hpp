@@ -0,0 +1,300 @@
+#ifndef PMM_LOOKUPPER_THREAD_POOL_HPP_
+#define PMM_LOOKUPPER_THREAD_POOL_HPP_
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace pmm_lookupper {
+
+	// Work-stealing pool. Every worker owns a deque: tasks posted from a worker go
+	// to the back of its own deque and are taken back LIFO, so a recursive job
+	// stays depth-first and cache-warm, while idle workers steal the oldest tasks
+	// from the front of the others. Tasks posted from outside go to a shared queue.
+	class thread_pool
+	{
+		using task_type = std::function< void() >;
+
+		struct queue_type
+		{
+			std::mutex mtx;
+			std::deque< task_type > tasks;
+		};
+
+		// Fixed before any worker starts, so workers never look at workers_. The
+		// shared queue is queues_[size_].
+		std::size_t const size_;
+		std::vector< std::unique_ptr< queue_type > > queues_;
+		std::vector< std::thread > workers_;
+		std::atomic< std::size_t > pending_;
+		std::mutex sleep_mtx_;
+		std::condition_variable cv_;
+		bool stop_;
+
+	public:
+		explicit thread_pool(std::size_t n = default_size()) :
+			size_( n ), pending_( 0 ), stop_( false )
+		{
+			for( std::size_t i = 0; i < n + 1; ++i ) {
+				queues_.emplace_back( new queue_type );
+			}
+			workers_.reserve( n );
+			for( std::size_t i = 0; i < n; ++i ) {
+				workers_.emplace_back( [this, i] { run( i ); } );
+			}
+		}
+
+		thread_pool(thread_pool const&) = delete;
+		thread_pool& operator=(thread_pool const&) = delete;
+
+		~thread_pool()
+		{
+			{
+				std::lock_guard< std::mutex > lock( sleep_mtx_ );
+				stop_ = true;
+			}
+			cv_.notify_all();
+
+			for( auto& t : workers_ ) {
+				t.join();
+			}
+		}
+
+		inline std::size_t size() const noexcept
+		{
+			return size_;
+		}
+
+		template <class F>
+		void post(F&& f)
+		{
+			// Counted before it is queued, so a worker taking it at once never
+			// brings pending_ below zero.
+			{
+				std::lock_guard< std::mutex > lock( sleep_mtx_ );
+				++pending_;
+			}
+			auto& q = *queues_[current_worker() == this ? current_index() : size_];
+			{
+				std::lock_guard< std::mutex > lock( q.mtx );
+				q.tasks.emplace_back( std::forward< F >( f ) );
+			}
+			cv_.notify_one();
+		}
+
+		static std::size_t default_size() noexcept
+		{
+			auto const n = std::thread::hardware_concurrency();
+			return n ? n : 1;
+		}
+
+	private:
+		static thread_pool*& current_worker() noexcept
+		{
+			static thread_local thread_pool* p = nullptr;
+			return p;
+		}
+
+		static std::size_t& current_index() noexcept
+		{
+			static thread_local std::size_t i = 0;
+			return i;
+		}
+
+		bool pop_back(std::size_t i, task_type& task)
+		{
+			auto& q = *queues_[i];
+			std::lock_guard< std::mutex > lock( q.mtx );
+			if( q.tasks.empty() ) {
+				return false;
+			}
+			task = std::move( q.tasks.back() );
+			q.tasks.pop_back();
+
+			return true;
+		}
+
+		bool pop_front(std::size_t i, task_type& task)
+		{
+			auto& q = *queues_[i];
+			std::lock_guard< std::mutex > lock( q.mtx );
+			if( q.tasks.empty() ) {
+				return false;
+			}
+			task = std::move( q.tasks.front() );
+			q.tasks.pop_front();
+
+			return true;
+		}
+
+		bool take(std::size_t self, task_type& task)
+		{
+			if( pop_back( self, task ) || pop_front( size_, task ) ) {
+				return true;
+			}
+
+			for( std::size_t k = 1; k < size_; ++k ) {
+				if( pop_front( ( self + k ) % size_, task ) ) {
+					return true;
+				}
+			}
+
+			return false;
+		}
+
+		// Decrements pending_, never past zero.
+		void release_pending() noexcept
+		{
+			auto n = pending_.load();
+			while( n > 0 && !pending_.compare_exchange_weak( n, n - 1 ) ) { }
+		}
+
+		void run(std::size_t self)
+		{
+			current_worker() = this;
+			current_index() = self;
+
+			for( ;; ) {
+				task_type task;
+				if( take( self, task ) ) {
+					release_pending();
+					task();
+					continue;
+				}
+
+				std::unique_lock< std::mutex > lock( sleep_mtx_ );
+				cv_.wait( lock, [this] { return stop_ || pending_ > 0; } );
+				if( stop_ && pending_ == 0 ) {
+					return;
+				}
+			}
+		}
+	};
+
+	// Tasks posted to a pool that can be waited for together. Tasks may add more
+	// tasks to the group while it is being waited for.
+	class task_group
+	{
+		thread_pool& pool_;
+		std::size_t count_;
+		std::mutex mtx_;
+		std::condition_variable cv_;
+		std::exception_ptr error_;
+
+	public:
+		explicit task_group(thread_pool& pool) noexcept :
+			pool_( pool ), count_( 0 )
+		{ }
+
+		task_group(task_group const&) = delete;
+		task_group& operator=(task_group const&) = delete;
+
+		~task_group()
+		{
+			std::unique_lock< std::mutex > lock( mtx_ );
+			cv_.wait( lock, [this] { return count_ == 0; } );
+		}
+
+		template <class F>
+		void run(F f)
+		{
+			{
+				std::lock_guard< std::mutex > lock( mtx_ );
+				++count_;
+			}
+
+			pool_.post( [this, f] {
+				try {
+					f();
+				}
+				catch( ... ) {
+					std::lock_guard< std::mutex > lock( mtx_ );
+					if( !error_ ) {
+						error_ = std::current_exception();
+					}
+				}
+
+				std::lock_guard< std::mutex > lock( mtx_ );
+				if( --count_ == 0 ) {
+					cv_.notify_all();
+				}
+			} );
+		}
+
+		// Blocks until every task has finished and rethrows the first exception.
+		// Must not be called from a task of the same pool.
+		void wait()
+		{
+			std::unique_lock< std::mutex > lock( mtx_ );
+			cv_.wait( lock, [this] { return count_ == 0; } );
+			if( error_ ) {
+				auto e = error_;
+				error_ = nullptr;
+				std::rethrow_exception( e );
+			}
+		}
+	};
+
+	// Calls f( i ) for every i in [0, n) on the pool and on the calling thread, and
+	// returns when all calls have finished. The first exception thrown by f is
+	// rethrown here. Like task_group::wait, not for use inside a task of the pool.
+	template <class F>
+	inline void parallel_for(thread_pool& pool, std::size_t n, F f)
+	{
+		struct state_type
+		{
+			std::atomic< std::size_t > next;
+			std::size_t helpers;
+			std::mutex mtx;
+			std::condition_variable cv;
+			std::exception_ptr error;
+		};
+
+		auto const st = std::make_shared< state_type >();
+		st->next = 0;
+		st->helpers = std::min( pool.size(), n > 0 ? n - 1 : 0 );
+
+		auto const work = [st, n, &f] {
+			for( auto i = st->next++; i < n; i = st->next++ ) {
+				try {
+					f( i );
+				}
+				catch( ... ) {
+					std::lock_guard< std::mutex > lock( st->mtx );
+					if( !st->error ) {
+						st->error = std::current_exception();
+					}
+				}
+			}
+		};
+
+		auto const helpers = st->helpers;
+		for( std::size_t i = 0; i < helpers; ++i ) {
+			pool.post( [st, work] {
+				work();
+				std::lock_guard< std::mutex > lock( st->mtx );
+				if( --st->helpers == 0 ) {
+					st->cv.notify_all();
+				}
+			} );
+		}
+
+		work();
+
+		std::unique_lock< std::mutex > lock( st->mtx );
+		st->cv.wait( lock, [&] { return st->helpers == 0; } );
+		if( st->error ) {
+			std::rethrow_exception( st->error );
+		}
+	}
+
+} // namespace pmm_lookupper
+
+#endif // PMM_LOOKUPPER_THREAD_POOL_HPP_
@@ -0,0 +1,148 @@
+#ifndef PMM_LOOKUPPER_VERIFY_HPP_
+#define PMM_LOOKUPPER_VERIFY_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <boost/range/algorithm.hpp>
+#include "engine.hpp"
+#include "filter.hpp"
+#include "path_identity.hpp"
+#include "query.hpp"
+#include "stat_cache.hpp"
+#include "string_pool.hpp"
+
+namespace pmm_lookupper {
+
+	struct asset_status
+	{
+		string_id path;
+		bool present;
+		std::uint64_t size;
+	};
+
+	// The assets one project refers to, each once and in path order.
+	struct project_report
+	{
+		std::string file;
+		bool error;
+		std::vector< asset_status > assets;
+		std::size_t missing;
+		std::uint64_t present_bytes;
+	};
+
+	// Totals count every file once, however many projects refer to it.
+	struct verify_report
+	{
+		std::vector< project_report > projects;
+		std::size_t assets;
+		std::size_t missing;
+		std::uint64_t present_bytes;
+	};
+
+	// Checks that the paths with one of exts that the projects refer to name
+	// existing files. Paths naming the same file are stat'ed once, all of them
+	// in parallel; their UTF-8 forms are interned in pool.
+	inline verify_report verify_assets(
+		std::vector< project > const& projects, std::vector< std::string > const& exts, string_pool& pool, stat_cache& stats
+	) {
+		verify_report report;
+		report.assets = 0;
+		report.missing = 0;
+		report.present_bytes = 0;
+
+		// The first id to name each file stands for the others; -1 until hashed.
+		std::vector< string_id > first;
+		path_identities identities;
+		id_list firsts;
+		std::vector< id_list > assets;
+		assets.reserve( projects.size() );
+
+		// The last project + 1 to refer to each first id.
+		std::vector< std::size_t > seen;
+		for( auto const& p : projects ) {
+			id_list ids;
+			for( auto const id : intern_paths( p.result.paths, pool ) ) {
+				if( !has_extension( pool[id], exts ) ) {
+					continue;
+				}
+				first.resize( pool.size(), static_cast< string_id >( -1 ) );
+				if( first[id] == static_cast< string_id >( -1 ) ) {
+					auto const file = identities.identify( pool[id] );
+					if( file == firsts.size() ) {
+						firsts.push_back( id );
+					}
+					first[id] = firsts[file];
+				}
+				seen.resize( pool.size(), 0 );
+				if( seen[first[id]] == assets.size() + 1 ) {
+					continue;
+				}
+				seen[first[id]] = assets.size() + 1;
+				ids.push_back( id );
+			}
+			assets.push_back( std::move( ids ) );
+		}
+
+		std::vector< char > queued( pool.size(), 0 );
+		std::vector< boost::string_ref > files;
+		for( auto const& ids : assets ) {
+			for( auto const id : ids ) {
+				if( !queued[first[id]] ) {
+					queued[first[id]] = 1;
+					files.push_back( pool[first[id]] );
+				}
+			}
+		}
+		stats.prefetch( files );
+
+		std::vector< char > counted( pool.size(), 0 );
+		report.projects.reserve( projects.size() );
+		for( std::size_t i = 0; i < projects.size(); ++i ) {
+			auto& ids = assets[i];
+			boost::sort( ids, [&pool](string_id lhs, string_id rhs) {
+				return pool[lhs] < pool[rhs];
+			} );
+
+			project_report r;
+			r.file = projects[i].file;
+			r.error = projects[i].result.error;
+			r.missing = 0;
+			r.present_bytes = 0;
+			r.assets.reserve( ids.size() );
+
+			for( auto const id : ids ) {
+				auto const st = stats.get( pool[first[id]] );
+				auto const present = st.exists && !st.is_directory;
+				auto const size = present ? st.size : 0;
+				r.assets.push_back( { id, present, size } );
+
+				if( present ) {
+					r.present_bytes += size;
+				}
+				else {
+					++r.missing;
+				}
+
+				if( !counted[first[id]] ) {
+					counted[first[id]] = 1;
+					++report.assets;
+					if( present ) {
+						report.present_bytes += size;
+					}
+					else {
+						++report.missing;
+					}
+				}
+			}
+
+			report.projects.push_back( std::move( r ) );
+		}
+
+		return report;
+	}
+
+} // namespace pmm_lookupper
+
+#endif // PMM_LOOKUPPER_VERIFY_HPP_
@@ -31,6 +31,7 @@
 #include <tuple>
 #include <type_traits>
 #include <boost/utility/string_ref.hpp>
+#include <boost/optional.hpp>
 #include <boost/range/algorithm.hpp>
 #include <boost/variant.hpp>
 #include "resource.h"
@@ -117,6 +118,24 @@ namespace pmm_lookupper {
 		return result;
 	}
 
+	inline boost::optional< std::string > get_environment_variable(boost::string_ref name)
+	{
+		auto const wname = multibyte_to_wide( name, CP_UTF8 );
+		auto const sz = GetEnvironmentVariableW( wname.c_str(), nullptr, 0 );
+		if( sz == 0 ) {
+			return boost::none;
+		}
+
+		std::wstring buf( sz, L'\0' );
+		auto const n = GetEnvironmentVariableW( wname.c_str(), &buf[0], sz );
+		if( n == 0 || n >= sz ) {
+			return boost::none;
+		}
+		buf.resize( n );
+
+		return wide_to_multibyte( buf, CP_UTF8 );
+	}
+
 	inline int message_box(boost::string_ref caption, boost::string_ref msg, UINT opts, HWND hwnd = nullptr) noexcept
 	{
 		return MessageBoxW( 
@@ -0,0 +1,42 @@
+#ifndef PMM_LOOKUPPER_TEST_CHECK_HPP_
+#define PMM_LOOKUPPER_TEST_CHECK_HPP_
+
+#include <cstdio>
+#include <string>
+
+// Each test program checks as it goes and returns finish() from main, which is
+// 1 when any check failed. Programs that need files take a scratch directory
+// as their first argument, and read fixtures from test/data, as they are run
+// from the top of the tree.
+namespace pmm_lookupper { namespace test {
+
+	inline int& failures() noexcept
+	{
+		static int n = 0;
+		return n;
+	}
+
+	inline bool check(bool ok, std::string const& what)
+	{
+		if( !ok ) {
+			std::fprintf( stderr, "FAIL: %s\n", what.c_str() );
+			++failures();
+		}
+
+		return ok;
+	}
+
+	inline int finish(char const* name)
+	{
+		if( failures() ) {
+			std::fprintf( stderr, "%s: %d failed\n", name, failures() );
+			return 1;
+		}
+
+		std::printf( "%s: ok\n", name );
+		return 0;
+	}
+
+} } // namespace pmm_lookupper::test
+
+#endif // PMM_LOOKUPPER_TEST_CHECK_HPP_
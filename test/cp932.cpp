@@ -0,0 +1,123 @@
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "../src/cp932.hpp"
+#include "check.hpp"
+
+namespace {
+
+	using pmm_lookupper::test::check;
+
+	std::string utf8(std::vector< std::uint32_t > const& code_points)
+	{
+		std::string result;
+		for( auto const u : code_points ) {
+			char buf[3];
+			result.append( buf, pmm_lookupper::cp932::put_utf8( u, buf ) );
+		}
+
+		return result;
+	}
+
+	std::string hex(std::string const& str)
+	{
+		static char const digits[] = "0123456789abcdef";
+
+		std::string result;
+		for( auto const c : str ) {
+			result += digits[static_cast< unsigned char >( c ) >> 4];
+			result += digits[static_cast< unsigned char >( c ) & 0xf];
+		}
+
+		return result;
+	}
+
+	void converts(std::string const& src, std::string const& expected)
+	{
+		auto const result = pmm_lookupper::cp932_to_utf8( src );
+		check( result == expected, hex( src ) + " gives " + hex( result ) + ", not " + hex( expected ) );
+	}
+
+	// ASCII runs of every length around the 16-byte blocks, alone and with a
+	// double-byte character at every position, across block ends too.
+	void ascii_runs()
+	{
+		for( std::size_t n = 0; n <= 50; ++n ) {
+			std::string ascii;
+			for( std::size_t i = 0; i < n; ++i ) {
+				ascii += static_cast< char >( 0x20 + i % 0x5f );
+			}
+			converts( ascii, ascii );
+
+			for( std::size_t k = 0; k <= n; ++k ) {
+				converts(
+					ascii.substr( 0, k ) + "\x82\xa0" + ascii.substr( k ),
+					ascii.substr( 0, k ) + "\xe3\x81\x82" + ascii.substr( k )
+				);
+			}
+		}
+	}
+
+	void half_width_kana()
+	{
+		converts( "\xa1\xb1\xdf", utf8( { 0xff61, 0xff71, 0xff9f } ) );
+		converts( "C:\\\xb1\\a.pmx", "C:\\" + utf8( { 0xff71 } ) + "\\a.pmx" );
+	}
+
+	// CP932 as Windows maps it, where it differs from plain Shift-JIS.
+	void vendor_rows()
+	{
+		converts( "\x81\x5c\x81\x60\x95\x5c", utf8( { 0x2015, 0xff5e, 0x8868 } ) );
+		// NEC special characters, row 13.
+		converts( "\x87\x40\x87\x5f\x87\x82\x87\x84", utf8( { 0x2460, 0x3349, 0x2116, 0x2121 } ) );
+		// NEC-selected IBM extensions, rows 89 to 92.
+		converts( "\xed\x40\xee\xfc", utf8( { 0x7e8a, 0xff02 } ) );
+		// IBM extensions, rows 115 to 119.
+		converts( "\xfa\x40\xfa\x54\xfa\x5c\xfc\x4b", utf8( { 0x2170, 0xffe2, 0x7e8a, 0x9ed1 } ) );
+	}
+
+	void broken_sequences()
+	{
+		converts( "a\x82", "a" + utf8( { 0x30fb } ) );
+		converts( std::string( 20, 'a' ) + "\x82", std::string( 20, 'a' ) + utf8( { 0x30fb } ) );
+		// A byte that cannot trail is read again on its own.
+		converts( "\x82\x20", utf8( { 0x30fb, 0x20 } ) );
+		converts( "\x82\x7f", utf8( { 0x30fb, 0x7f } ) );
+		// A pair that can be one but is not mapped is a single character.
+		converts( "\x85\x40" "a", utf8( { 0x30fb, 'a' } ) );
+	}
+
+	// Only half-width kana and other single bytes above ASCII take all of
+	// utf8_capacity.
+	void fills_capacity()
+	{
+		for( std::size_t n = 0; n <= 40; ++n ) {
+			std::string const src( n, '\xb1' );
+			std::vector< char > buf( pmm_lookupper::utf8_capacity( n ) + 1, '#' );
+			auto const last = pmm_lookupper::cp932_to_utf8( src, buf.data() );
+			check( last == buf.data() + pmm_lookupper::utf8_capacity( n ), "output does not fill the capacity" );
+			check( buf.back() == '#', "output past the capacity" );
+			check( std::string( buf.data(), last ) == utf8( std::vector< std::uint32_t >( n, 0xff71 ) ), "wrong output at capacity" );
+		}
+
+		std::string dest( "prefix" );
+		pmm_lookupper::cp932_to_utf8( std::string( 5, '\xb1' ), dest );
+		check( dest == "prefix" + utf8( std::vector< std::uint32_t >( 5, 0xff71 ) ), "appending output" );
+	}
+
+} // namespace
+
+int main()
+{
+	ascii_runs();
+	half_width_kana();
+	vendor_rows();
+	broken_sequences();
+	fills_capacity();
+
+#if defined( PMM_LOOKUPPER_CP932_SSE2 )
+	return pmm_lookupper::test::finish( "cp932" );
+#else
+	return pmm_lookupper::test::finish( "cp932 (no SSE2)" );
+#endif
+}
@@ -0,0 +1,44 @@
+#include <string>
+#include <vector>
+#include "../src/emm.hpp"
+#include "check.hpp"
+
+namespace {
+
+	using pmm_lookupper::test::check;
+
+	std::vector< std::string > paths_of(pmm_lookupper::path_list const& paths)
+	{
+		std::vector< std::string > result;
+		for( std::size_t i = 0; i < paths.size(); ++i ) {
+			result.push_back( paths[i].to_string() );
+		}
+
+		return result;
+	}
+
+	// Effects are assigned in [Effect], in [Effect@...] and in sections an
+	// offscreen render target names itself; [Info] and [Object] hold none.
+	void effects_of_every_section()
+	{
+		auto const paths = pmm_lookupper::parse_emm_file( "test/data/offscreen.emm" );
+		if( !check( !!paths, "offscreen.emm is not an EMM file" ) ) {
+			return;
+		}
+
+		std::vector< std::string > const expected = {
+			"C:\\MMD\\Effect\\ikPolishShader\\ikPolishShader.fx",
+			"C:\\MMD\\Effect\\ikPolishShader\\shadow\\ikShadowBuffer.fxsub",
+			"D:\\Effects\\Mirror\\MirrorObject.fx"
+		};
+		check( paths_of( *paths ) == expected, "wrong effects in offscreen.emm" );
+	}
+
+} // namespace
+
+int main()
+{
+	effects_of_every_section();
+
+	return pmm_lookupper::test::finish( "emm" );
+}
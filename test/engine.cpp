@@ -0,0 +1,106 @@
+#include <memory>
+#include <string>
+#include <vector>
+#include "../src/path_sources.hpp"
+#include "../bench/corpus.hpp"
+#include "check.hpp"
+
+namespace {
+
+	using pmm_lookupper::test::check;
+
+	bool same(pmm_lookupper::path_list const& lhs, pmm_lookupper::path_list const& rhs)
+	{
+		if( lhs.size() != rhs.size() ) {
+			return false;
+		}
+		for( std::size_t i = 0; i < lhs.size(); ++i ) {
+			if( lhs[i] != rhs[i] ) {
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	// Two copies of a scene and a different scene of the same size are scanned as
+	// one group; each input still gets its own paths, and the sources name every
+	// copy.
+	void copies_keep_their_paths(std::string const& dir)
+	{
+		namespace bench = pmm_lookupper::bench;
+
+		bench::pmm_spec const spec = { 2, 4, 8, 4, 0, 2 };
+		auto const scene = bench::make_pmm( spec, 1 );
+		auto const other = bench::make_pmm( spec, 2 );
+		if( !check( scene.size() == other.size() && scene != other, "scenes differ in size or not at all" ) ) {
+			return;
+		}
+
+		std::vector< std::string > files;
+		std::vector< pmm_lookupper::path_list > expected;
+		for( auto const name : { "copy_a.pmm", "copy_b.pmm", "other.pmm" } ) {
+			auto const& data = files.size() < 2 ? scene : other;
+			files.push_back( pmm_lookupper::join_path( dir, name ) );
+			expected.push_back( *pmm_lookupper::parse_pmm_buffer( boost::string_ref( data.data(), data.size() ) ) );
+			if( !check( bench::write_file( files.back(), data ), "cannot write " + files.back() ) ) {
+				return;
+			}
+		}
+
+		auto const cache_file = pmm_lookupper::join_path( dir, "copies.bin" );
+		pmm_lookupper::remove_file( cache_file );
+
+		pmm_lookupper::thread_pool pool( 4 );
+		for( int run = 0; run < 3; ++run ) {
+			// Without a cache, then with an empty one, then with the one just saved.
+			std::unique_ptr< pmm_lookupper::scan_cache > cache;
+			if( run > 0 ) {
+				cache.reset( new pmm_lookupper::scan_cache( cache_file ) );
+			}
+			auto const what = " in run " + std::to_string( run );
+
+			auto const projects = pmm_lookupper::crawl_projects( files, pool, cache.get() );
+			if( !check( projects.size() == files.size(), "projects missing" + what ) ) {
+				return;
+			}
+			for( std::size_t i = 0; i < files.size(); ++i ) {
+				check( projects[i].file == files[i], "projects out of order" + what );
+				check( !projects[i].result.error, "error for " + files[i] + what );
+				check( same( projects[i].result.paths, expected[i] ), "wrong paths for " + files[i] + what );
+			}
+
+			pmm_lookupper::string_pool strings;
+			auto const sources = pmm_lookupper::intern_projects( projects, strings );
+			check( sources.files == files, "sources do not name every file" + what );
+			std::size_t k = 0;
+			for( std::size_t i = 0; i < files.size(); ++i ) {
+				auto const ids = pmm_lookupper::intern_paths( expected[i], strings );
+				for( auto const id : ids ) {
+					check( k < sources.ids.size() && sources.ids[k] == id && sources.file_of[k] == i, "path attributed to the wrong file" + what );
+					++k;
+				}
+			}
+			check( k == sources.ids.size(), "extra paths in the sources" + what );
+
+			if( cache ) {
+				check( cache->save(), "cannot save the cache" + what );
+			}
+		}
+
+		for( auto const& f : files ) {
+			pmm_lookupper::remove_file( f );
+		}
+		pmm_lookupper::remove_file( cache_file );
+	}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+	std::string const dir = argc > 1 ? argv[1] : ".";
+
+	copies_keep_their_paths( dir );
+
+	return pmm_lookupper::test::finish( "engine" );
+}
@@ -0,0 +1,168 @@
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+#include <zlib.h>
+#include "../src/export.hpp"
+#include "check.hpp"
+
+namespace {
+
+	using pmm_lookupper::test::check;
+
+	std::string read_file(std::string const& file)
+	{
+		std::ifstream ifs( file, std::ios::binary );
+		return std::string( std::istreambuf_iterator< char >( ifs ), std::istreambuf_iterator< char >() );
+	}
+
+	// The contents of a gzip file, or "<broken>" when it does not inflate whole.
+	std::string inflate_file(std::string const& file)
+	{
+		auto const in = read_file( file );
+
+		z_stream z;
+		std::memset( &z, 0, sizeof( z ) );
+		if( inflateInit2( &z, 15 + 16 ) != Z_OK ) {
+			return "<broken>";
+		}
+
+		std::string result;
+		std::vector< char > buf( 64 * 1024 );
+		z.next_in = reinterpret_cast< Bytef* >( const_cast< char* >( in.data() ) );
+		z.avail_in = static_cast< uInt >( in.size() );
+		int rc = Z_OK;
+		while( rc == Z_OK ) {
+			z.next_out = reinterpret_cast< Bytef* >( buf.data() );
+			z.avail_out = static_cast< uInt >( buf.size() );
+			rc = inflate( &z, Z_NO_FLUSH );
+			result.append( buf.data(), buf.size() - z.avail_out );
+		}
+		bool const whole = rc == Z_STREAM_END && z.avail_in == 0;
+		inflateEnd( &z );
+
+		return whole ? result : "<broken>";
+	}
+
+	struct fixture
+	{
+		pmm_lookupper::string_pool strings;
+		pmm_lookupper::path_sources sources;
+		pmm_lookupper::id_list rows;
+	};
+
+	// Two scenes, each holding a.pmx, the second twice, and rows with a.pmx twice
+	// and a folder that neither holds.
+	void make_fixture(fixture& f)
+	{
+		pmm_lookupper::path_list paths;
+		for( auto const p : { "C:\\a.pmx", "D:\\b\\c.x", "C:\\a.pmx" } ) {
+			paths.push_back( p );
+		}
+		paths.push_back( "C:\\a.pmx" );
+
+		f.sources.files = { "E:\\one.pmm", "E:\\two.pmm" };
+		f.sources.ids = pmm_lookupper::intern_paths( paths, f.strings );
+		f.sources.file_of = { 0, 0, 1, 1 };
+
+		auto const folder = f.strings.intern( "D:\\b" );
+		f.rows = { f.sources.ids[0], f.sources.ids[1], f.sources.ids[0], folder };
+	}
+
+	std::string exported(std::string const& file, fixture const& f, pmm_lookupper::path_sources const* sources, pmm_lookupper::export_options const& opts)
+	{
+		if( !check( pmm_lookupper::export_rows( file, f.strings, f.rows, sources, opts ), "cannot write " + file ) ) {
+			return {};
+		}
+
+		return opts.gzip ? inflate_file( file ) : read_file( file );
+	}
+
+	void formats(std::string const& dir)
+	{
+		fixture f;
+		make_fixture( f );
+		auto const file = pmm_lookupper::join_path( dir, "export.out" );
+
+		std::string const text = "C:\\a.pmx\r\nD:\\b\\c.x\r\nC:\\a.pmx\r\nD:\\b\r\n";
+		std::string const tsv =
+			"path\tsource\textension\r\n"
+			"C:\\a.pmx\tE:\\one.pmm\t.pmx\r\n"
+			"D:\\b\\c.x\tE:\\one.pmm\t.x\r\n"
+			"C:\\a.pmx\tE:\\two.pmm\t.pmx\r\n"
+			"D:\\b\t\t\r\n";
+		std::string const ndjson =
+			"{\"path\":\"C:\\\\a.pmx\",\"source\":\"E:\\\\one.pmm\",\"extension\":\".pmx\"}\n"
+			"{\"path\":\"D:\\\\b\\\\c.x\",\"source\":\"E:\\\\one.pmm\",\"extension\":\".x\"}\n"
+			"{\"path\":\"C:\\\\a.pmx\",\"source\":\"E:\\\\two.pmm\",\"extension\":\".pmx\"}\n"
+			"{\"path\":\"D:\\\\b\",\"source\":null,\"extension\":\"\"}\n";
+
+		using pmm_lookupper::export_format;
+		check( exported( file, f, &f.sources, { export_format::text, false } ) == text, "text export" );
+		check( exported( file, f, &f.sources, { export_format::tsv, false } ) == tsv, "TSV export" );
+		check( exported( file, f, &f.sources, { export_format::ndjson, false } ) == ndjson, "NDJSON export" );
+
+		check( exported( file, f, &f.sources, { export_format::text, true } ) == text, "gzip text export" );
+		check( exported( file, f, &f.sources, { export_format::tsv, true } ) == tsv, "gzip TSV export" );
+		check( exported( file, f, &f.sources, { export_format::ndjson, true } ) == ndjson, "gzip NDJSON export" );
+
+		// Without sources the column is left empty.
+		check(
+			exported( file, f, nullptr, { export_format::tsv, false } )
+				== "path\tsource\textension\r\nC:\\a.pmx\t\t.pmx\r\nD:\\b\\c.x\t\t.x\r\nC:\\a.pmx\t\t.pmx\r\nD:\\b\t\t\r\n",
+			"TSV export without sources"
+		);
+		check(
+			exported( file, f, nullptr, { export_format::ndjson, false } ).find( "\"source\":null" ) != std::string::npos,
+			"NDJSON export without sources"
+		);
+
+		pmm_lookupper::remove_file( file );
+	}
+
+	void json_escaping(std::string const& dir)
+	{
+		fixture f;
+		f.rows = { f.strings.intern( std::string( "C:\\q\"x\x01\x1f\t\x7f\x82\xa0.fx", 15 ) ) };
+		auto const file = pmm_lookupper::join_path( dir, "escape.ndjson" );
+
+		check(
+			exported( file, f, nullptr, { pmm_lookupper::export_format::ndjson, false } )
+				== "{\"path\":\"C:\\\\q\\\"x\\u0001\\u001f\\u0009\x7f\x82\xa0.fx\",\"source\":null,\"extension\":\".fx\"}\n",
+			"JSON escaping"
+		);
+
+		pmm_lookupper::remove_file( file );
+	}
+
+	// Larger than the write buffer, so the deflate stream is flushed midway.
+	void large_gzip(std::string const& dir)
+	{
+		fixture f;
+		for( int i = 0; i < 100000; ++i ) {
+			f.rows.push_back( f.strings.intern( "C:\\MMD\\Model\\model_" + std::to_string( i ) + ".pmx" ) );
+		}
+		auto const plain = pmm_lookupper::join_path( dir, "large.tsv" );
+		auto const packed = pmm_lookupper::join_path( dir, "large.tsv.gz" );
+
+		auto const expected = exported( plain, f, nullptr, pmm_lookupper::export_options_of( plain ) );
+		check( expected.size() > 2 * 1024 * 1024, "large export too small" );
+		check( exported( packed, f, nullptr, pmm_lookupper::export_options_of( packed ) ) == expected, "large gzip export" );
+
+		pmm_lookupper::remove_file( plain );
+		pmm_lookupper::remove_file( packed );
+	}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+	std::string const dir = argc > 1 ? argv[1] : ".";
+
+	formats( dir );
+	json_escaping( dir );
+	large_gzip( dir );
+
+	return pmm_lookupper::test::finish( "export" );
+}
@@ -0,0 +1,141 @@
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+#include "../src/filter_engine.hpp"
+#include "../bench/corpus.hpp"
+#include "check.hpp"
+
+namespace {
+
+	using pmm_lookupper::test::check;
+
+	struct corpus
+	{
+		std::shared_ptr< pmm_lookupper::string_pool > strings;
+		pmm_lookupper::id_list ids;
+	};
+
+	corpus make_corpus(std::size_t n, std::uint32_t seed)
+	{
+		corpus c;
+		c.strings = std::make_shared< pmm_lookupper::string_pool >();
+		c.ids = pmm_lookupper::intern_paths( pmm_lookupper::bench::make_paths( n, seed ), *c.strings );
+
+		return c;
+	}
+
+	pmm_lookupper::query_options make_options(std::string const& exts, bool folder_only, bool duplication, pmm_lookupper::sort_order order)
+	{
+		pmm_lookupper::query_options opts;
+		opts.extensions = pmm_lookupper::parse_extensions( exts );
+		opts.folder_only = folder_only;
+		opts.duplication = duplication;
+		opts.order = order;
+
+		return opts;
+	}
+
+	std::vector< std::string > strings_of(pmm_lookupper::id_list const& ids, pmm_lookupper::string_pool const& pool)
+	{
+		std::vector< std::string > result;
+		for( auto const id : ids ) {
+			result.push_back( pool[id].to_string() );
+		}
+
+		return result;
+	}
+
+	// make_paths with some paths repeated under a lower-case drive and an
+	// upper-case extension, which name the same file.
+	pmm_lookupper::path_list make_mixed_case_paths(std::size_t n, std::mt19937& rng)
+	{
+		auto const paths = pmm_lookupper::bench::make_paths( n, static_cast< std::uint32_t >( rng() ) );
+
+		pmm_lookupper::path_list result;
+		for( std::size_t i = 0; i < paths.size(); ++i ) {
+			result.push_back( paths[i] );
+			if( rng() % 4 == 0 ) {
+				auto path = paths[i].to_string();
+				path[0] = static_cast< char >( path[0] - 'A' + 'a' );
+				for( auto j = path.find_last_of( '.' ) + 1; j < path.size(); ++j ) {
+					if( path[j] >= 'a' && path[j] <= 'z' ) {
+						path[j] = static_cast< char >( path[j] - 'a' + 'A' );
+					}
+				}
+				result.push_back( path );
+			}
+		}
+
+		return result;
+	}
+
+	// Random sequences of queries on one engine, so that the incremental paths
+	// run too, against run_query from scratch on a pool of the same ids.
+	void matches_run_query()
+	{
+		static char const* const exts[] = { "pmx", "pmd", "x", "wav", "bmp", "fx", "fxsub", "png", "PMX", "Fx", "txt" };
+		static pmm_lookupper::sort_order const orders[] = {
+			pmm_lookupper::sort_order::path, pmm_lookupper::sort_order::extension, pmm_lookupper::sort_order::input
+		};
+
+		std::mt19937 rng( 14 );
+		for( int round = 0; round < 30; ++round ) {
+			auto const paths = make_mixed_case_paths( 50 + rng() % 3000, rng );
+
+			auto strings = std::make_shared< pmm_lookupper::string_pool >();
+			auto const ids = pmm_lookupper::intern_paths( paths, *strings );
+			pmm_lookupper::filter_engine engine( strings, ids );
+
+			pmm_lookupper::string_pool pool;
+			auto const data = pmm_lookupper::intern_paths( paths, pool );
+			pmm_lookupper::sort_keys const keys( pool );
+			pmm_lookupper::path_aliases const aliases( data, pool );
+
+			for( int q = 0; q < 20; ++q ) {
+				std::string selected;
+				for( auto const e : exts ) {
+					if( rng() % 3 == 0 ) {
+						selected += std::string( e ) + " ";
+					}
+				}
+				auto const opts = make_options( selected, rng() % 5 == 0, rng() % 2 == 0, orders[rng() % 3] );
+
+				auto const expected = strings_of( pmm_lookupper::run_query( data, pool, keys, aliases, opts ), pool );
+				if( !check( strings_of( engine.query( opts ), *strings ) == expected, "filter_engine differs from run_query, round " + std::to_string( round ) ) ) {
+					return;
+				}
+			}
+		}
+	}
+
+	// A cancelled query returns nothing and leaves no half-built state behind.
+	void cancelled_query_starts_over()
+	{
+		auto const c = make_corpus( 2000, 7 );
+		pmm_lookupper::cancel_token cancel;
+		cancel.cancel();
+
+		auto const narrow = make_options( "pmx", false, false, pmm_lookupper::sort_order::path );
+		auto const wide = make_options( "pmx x wav fx", false, false, pmm_lookupper::sort_order::path );
+		auto const folders = make_options( "", true, false, pmm_lookupper::sort_order::path );
+
+		pmm_lookupper::filter_engine engine( c.strings, c.ids );
+		pmm_lookupper::filter_engine fresh( c.strings, c.ids );
+		engine.query( narrow );
+		check( engine.query( wide, &cancel ).empty(), "a cancelled query returned rows" );
+		check( engine.query( wide ) == fresh.query( wide ), "a cancelled query left its state behind" );
+
+		check( engine.query( folders, &cancel ).empty(), "a cancelled folder query returned rows" );
+		check( engine.query( folders ) == fresh.query( folders ), "a cancelled folder query was cached" );
+	}
+
+} // namespace
+
+int main()
+{
+	matches_run_query();
+	cancelled_query_starts_over();
+
+	return pmm_lookupper::test::finish( "filter_engine" );
+}
@@ -0,0 +1,42 @@
+#include <string>
+#include <vector>
+#include "../src/options.hpp"
+#include "check.hpp"
+
+namespace {
+
+	using pmm_lookupper::test::check;
+	using pmm_lookupper::flag_match;
+
+	std::vector< std::string > const args = {
+		"pmm_lookupper_cli", "C:\\my-data", "-d", "D:\\scene-final.pmm", "-e", "pmx fx", "-s", "ext", "E:\\x-f"
+	};
+
+	void flags_match_exactly()
+	{
+		auto const opts = pmm_lookupper::parse_command_line_options( args );
+		check( opts.duplication, "-d not read" );
+		check( !opts.folder_only, "-f read from a path" );
+		check( opts.extensions && *opts.extensions == "pmx fx", "-e not read" );
+		check( opts.order && *opts.order == pmm_lookupper::sort_order::extension, "-s not read" );
+		check( opts.files == std::vector< std::string >( { "C:\\my-data", "D:\\scene-final.pmm", "E:\\x-f" } ), "paths taken as flags" );
+	}
+
+	// What the window has always done.
+	void flags_match_anywhere()
+	{
+		auto const opts = pmm_lookupper::parse_command_line_options( args, flag_match::anywhere );
+		check( opts.duplication, "-d not read" );
+		check( opts.folder_only, "-f not read from a path" );
+		check( opts.files.empty(), "legacy matching changed" );
+	}
+
+} // namespace
+
+int main()
+{
+	flags_match_exactly();
+	flags_match_anywhere();
+
+	return pmm_lookupper::test::finish( "options" );
+}
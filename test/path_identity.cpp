@@ -0,0 +1,52 @@
+#include <string>
+#include "../src/path_identity.hpp"
+#include "check.hpp"
+
+namespace {
+
+	using pmm_lookupper::test::check;
+
+	void folds_as_windows_names_files()
+	{
+		check( pmm_lookupper::fold_path( "C:\\MMD\\Model\\..\\Model\\a.pmx" ) == "c:\\mmd\\model\\a.pmx", "fold of .." );
+		check( pmm_lookupper::fold_path( "C:/MMD//./a.PMX" ) == "c:\\mmd\\a.pmx", "fold of separators" );
+		check( pmm_lookupper::fold_path( "C:\\..\\a.pmx" ) == "c:\\a.pmx", ".. past the drive" );
+		// Only ASCII is folded: full-width Ａ stays apart from ａ.
+		check( pmm_lookupper::fold_path( "C:\\\x82\x60.pmx" ) != pmm_lookupper::fold_path( "C:\\\x82\x81.pmx" ), "full-width letters folded" );
+	}
+
+	void identities_are_exact()
+	{
+		pmm_lookupper::path_identities files;
+		auto const a = files.identify( "C:\\MMD\\a.pmx" );
+		check( files.identify( "c:/mmd/A.PMX" ) == a, "same file, other case" );
+		check( files.identify( "C:\\MMD\\b.pmx" ) != a, "other file, same id" );
+		check( files.size() == 2, "wrong number of files" );
+
+		check( !files.add( "C:\\MMD\\.\\A.pmx" ), "known file added again" );
+		check( files.add( "C:\\MMD\\c.pmx" ), "new file not added" );
+	}
+
+	void aliases_keep_first()
+	{
+		pmm_lookupper::string_pool pool;
+		pmm_lookupper::id_list data;
+		for( auto const p : { "C:\\x\\b.pmx", "C:\\X\\B.pmx", "C:\\x\\c.pmx", "c:\\x\\b.pmx", "C:\\x\\b.pmx" } ) {
+			data.push_back( pool.intern( p ) );
+		}
+
+		pmm_lookupper::path_aliases const aliases( data, pool );
+		check( aliases.is_first( data[0] ) && aliases.is_first( data[2] ), "first paths not kept" );
+		check( !aliases.is_first( data[1] ) && aliases.first( data[3] ) == data[0], "aliases not found" );
+	}
+
+} // namespace
+
+int main()
+{
+	folds_as_windows_names_files();
+	identities_are_exact();
+	aliases_keep_first();
+
+	return pmm_lookupper::test::finish( "path_identity" );
+}
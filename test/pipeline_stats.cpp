@@ -0,0 +1,177 @@
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <string>
+#include "../src/filter_engine.hpp"
+#include "../src/pipeline_stats.hpp"
+#include "../bench/corpus.hpp"
+#include "check.hpp"
+
+namespace {
+
+	using pmm_lookupper::test::check;
+
+	using pmm_lookupper::latency_histogram;
+
+	void buckets()
+	{
+		latency_histogram h;
+		h.record( 0 );
+		h.record( 1 );
+		h.record( 2 );
+		h.record( 3 );
+		h.record( 4 );
+		check( h.count( 0 ) == 1 && h.count( 1 ) == 1 && h.count( 2 ) == 2 && h.count( 3 ) == 1, "small latencies in the wrong buckets" );
+		check( h.count() == 5 && h.total_ns() == 10 && h.max_ns() == 4, "wrong totals of small latencies" );
+
+		// Anything from 2^46 up lands in the last bucket.
+		auto const last = latency_histogram::buckets - 1;
+		latency_histogram large;
+		large.record( ( std::uint64_t( 1 ) << ( last - 1 ) ) - 1 );
+		check( large.count( last - 1 ) == 1, "2^46 - 1 not in the bucket before the last" );
+		for( auto const ns : { std::uint64_t( 1 ) << ( last - 1 ), std::uint64_t( 1 ) << last, std::uint64_t( 1 ) << 63, std::numeric_limits< std::uint64_t >::max() } ) {
+			latency_histogram one;
+			one.record( ns );
+			check( one.count( last ) == 1 && one.count() == 1 && one.max_ns() == ns, std::to_string( ns ) + " not in the last bucket" );
+		}
+
+		h.reset();
+		check( h.count() == 0 && h.total_ns() == 0 && h.max_ns() == 0, "histogram not reset" );
+	}
+
+	// 90 runs of 100 ns, 9 of 1000 ns and one of 1 ms: percentiles give the upper
+	// bound of the bucket holding them.
+	void percentiles()
+	{
+		latency_histogram h;
+		check( h.percentile_ns( 50.0 ) == 0, "percentile of nothing" );
+
+		for( int i = 0; i < 90; ++i ) {
+			h.record( 100 );
+		}
+		for( int i = 0; i < 9; ++i ) {
+			h.record( 1000 );
+		}
+		h.record( 1000000 );
+
+		check( h.percentile_ns( 50.0 ) == 128, "p50 is " + std::to_string( h.percentile_ns( 50.0 ) ) );
+		check( h.percentile_ns( 90.0 ) == 128, "p90 is " + std::to_string( h.percentile_ns( 90.0 ) ) );
+		check( h.percentile_ns( 99.0 ) == 1024, "p99 is " + std::to_string( h.percentile_ns( 99.0 ) ) );
+		// A rank between two runs takes the later one.
+		check( h.percentile_ns( 99.5 ) == 1048576, "p99.5 is " + std::to_string( h.percentile_ns( 99.5 ) ) );
+		check( h.percentile_ns( 100.0 ) == 1048576, "p100 is " + std::to_string( h.percentile_ns( 100.0 ) ) );
+	}
+
+	std::string empty_stage(std::string const& name)
+	{
+		return "\"" + name + "\":{\"count\":0,\"total_ns\":0,\"max_ns\":0,\"p50_ns\":0,\"p99_ns\":0,\"histogram\":[]}";
+	}
+
+	void json_shape()
+	{
+		pmm_lookupper::pipeline_stats s;
+		s.add( pmm_lookupper::stat_counter::files_read, 3 );
+		s.add( pmm_lookupper::stat_counter::bytes_read, 4096 );
+		s.add( pmm_lookupper::stat_counter::files_read, 1 );
+		s.record( pmm_lookupper::stat_stage::read, std::chrono::nanoseconds( 100 ) );
+		s.record( pmm_lookupper::stat_stage::read, std::chrono::nanoseconds( 1000 ) );
+		s.record( pmm_lookupper::stat_stage::sort, std::chrono::nanoseconds( 0 ) );
+
+		std::string const expected =
+			"{\"counters\":{\"files_read\":4,\"bytes_read\":4096,\"candidates\":0,\"paths_emitted\":0,\"filtered_out\":0,\"duplicates_removed\":0},"
+			"\"stages\":{"
+			"\"read\":{\"count\":2,\"total_ns\":1100,\"max_ns\":1000,\"p50_ns\":128,\"p99_ns\":1024,\"histogram\":[[128,1],[1024,1]]},"
+			+ empty_stage( "scan" ) + "," + empty_stage( "convert" ) + "," + empty_stage( "index" ) + ","
+			+ empty_stage( "filter" ) + "," + empty_stage( "folders" ) + ","
+			"\"sort\":{\"count\":1,\"total_ns\":0,\"max_ns\":0,\"p50_ns\":1,\"p99_ns\":1,\"histogram\":[[1,1]]}"
+			"}}";
+		check( s.to_json() == expected, "JSON is " + s.to_json() );
+
+		s.reset();
+		check( s.to_json().find( "\"files_read\":0," ) != std::string::npos && s.get( pmm_lookupper::stat_stage::read ).count() == 0, "stats not reset" );
+	}
+
+	pmm_lookupper::query_options make_options(std::string const& exts, bool folder_only, bool duplication)
+	{
+		pmm_lookupper::query_options opts;
+		opts.extensions = pmm_lookupper::parse_extensions( exts );
+		opts.folder_only = folder_only;
+		opts.duplication = duplication;
+		opts.order = pmm_lookupper::sort_order::path;
+
+		return opts;
+	}
+
+	// Paths with every tenth repeated, so that deduplication removes some.
+	pmm_lookupper::path_list make_data()
+	{
+		auto const paths = pmm_lookupper::bench::make_paths( 3000, 5 );
+		pmm_lookupper::path_list data;
+		for( std::size_t i = 0; i < paths.size(); ++i ) {
+			data.push_back( paths[i] );
+			if( i % 10 == 0 ) {
+				data.push_back( paths[i] );
+			}
+		}
+
+		return data;
+	}
+
+	// Nothing is counted while no stats are installed, and every path of a query
+	// is either filtered out, removed as a duplicate or in the result.
+	void query_counts()
+	{
+		auto const paths = make_data();
+		pmm_lookupper::string_pool pool;
+		auto const data = pmm_lookupper::intern_paths( paths, pool );
+		pmm_lookupper::sort_keys const keys( pool );
+		pmm_lookupper::path_aliases const aliases( data, pool );
+
+		auto strings = std::make_shared< pmm_lookupper::string_pool >();
+		auto const ids = pmm_lookupper::intern_paths( paths, *strings );
+		pmm_lookupper::filter_engine engine( strings, ids );
+
+		pmm_lookupper::pipeline_stats s;
+		auto const narrow = make_options( "pmx", false, false );
+		pmm_lookupper::install_pipeline_stats( nullptr );
+		pmm_lookupper::run_query( data, pool, keys, aliases, narrow );
+		engine.query( narrow );
+		pmm_lookupper::count_stat( pmm_lookupper::stat_counter::candidates, 1 );
+		check( !pmm_lookupper::stage_timer( pmm_lookupper::stat_stage::sort ).active(), "timer active without stats" );
+		check( s.to_json() == pmm_lookupper::pipeline_stats().to_json(), "counted without stats installed" );
+
+		auto const filtered_out = pmm_lookupper::stat_counter::filtered_out;
+		auto const duplicates_removed = pmm_lookupper::stat_counter::duplicates_removed;
+		for( auto const& opts : {
+			narrow, make_options( "pmx x wav", false, false ), make_options( "pmx x", false, true ),
+			make_options( "txt", false, false ), make_options( "", true, false ), make_options( "", true, true )
+		} ) {
+			auto const what = " for \"" + ( opts.extensions.empty() ? std::string() : opts.extensions[0] ) + "\"" + ( opts.folder_only ? " folders" : "" )
+				+ ( opts.duplication ? " with duplicates" : "" );
+
+			s.reset();
+			pmm_lookupper::install_pipeline_stats( &s );
+			auto const result = pmm_lookupper::run_query( data, pool, keys, aliases, opts );
+			pmm_lookupper::install_pipeline_stats( nullptr );
+			check( s.get( filtered_out ) + s.get( duplicates_removed ) + result.size() == data.size(), "run_query counts do not add up" + what );
+			check( opts.duplication || result.empty() || s.get( duplicates_removed ) > 0, "no duplicates removed" + what );
+
+			s.reset();
+			pmm_lookupper::install_pipeline_stats( &s );
+			auto const rows = engine.query( opts ).size();
+			pmm_lookupper::install_pipeline_stats( nullptr );
+			check( rows == result.size() && s.get( filtered_out ) + s.get( duplicates_removed ) + rows == data.size(), "filter_engine counts do not add up" + what );
+		}
+	}
+
+} // namespace
+
+int main()
+{
+	buckets();
+	percentiles();
+	json_shape();
+	query_counts();
+
+	return pmm_lookupper::test::finish( "pipeline_stats" );
+}
@@ -0,0 +1,149 @@
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+#include "../src/pmm.hpp"
+#include "../bench/corpus.hpp"
+#include "check.hpp"
+
+// test/data/scene_v1.pmm and scene_v2.pmm are bench::make_pmm( { v, 2, 3, 2, 2, 1 }, 3 )
+// with a decoy path, "\0Z:\decoy\a.pmx\0", written over the keyframes of the
+// first bone at decoy_offset. Reading the layout skips it; scanning finds it.
+namespace {
+
+	using pmm_lookupper::test::check;
+
+	std::size_t const decoy_offset[] = { 0, 501, 427 };
+
+	std::string const decoy = "Z:\\decoy\\a.pmx";
+
+	std::vector< std::string > const scene_paths = {
+		"C:\\MMD\\UserFile\\Model\\\x8f\x89\x89\xb9\x83~\x83N\\\x95\\\x8e\xa6_6.pmx",
+		"C:\\MMD\\UserFile\\Model\\\x8f\x89\x89\xb9\x83~\x83N\\\x95\\\x8e\xa6_7.pmx",
+		"D:\\MMD\\Accessory\\\x83X\x83" "e\x81[\x83W\\stage_3.x",
+		"C:\\MMD\\Music\\\x8b\xc8.wav"
+	};
+
+	std::string read_fixture(int version)
+	{
+		std::ifstream ifs( "test/data/scene_v" + std::to_string( version ) + ".pmm", std::ios::binary );
+		return std::string( std::istreambuf_iterator< char >( ifs ), std::istreambuf_iterator< char >() );
+	}
+
+	std::vector< std::string > paths_of(std::string const& buf, std::vector< pmm_lookupper::path_span > const& spans)
+	{
+		std::vector< std::string > result;
+		for( auto const& s : spans ) {
+			result.push_back( buf.substr( s.offset, s.length ) );
+		}
+
+		return result;
+	}
+
+	void layout(int version)
+	{
+		auto const name = "scene_v" + std::to_string( version );
+		auto const buf = read_fixture( version );
+		if( !check( pmm_lookupper::is_pmm_file( buf ), name + " is not a .pmm" ) ) {
+			return;
+		}
+
+		auto const spans = pmm_lookupper::parse_pmm_path_spans( buf );
+		if( check( !!spans, name + ": layout not read" ) ) {
+			check( paths_of( buf, *spans ) == scene_paths, name + ": wrong paths from the layout" );
+		}
+
+		auto expected = scene_paths;
+		expected.insert( expected.begin() + 1, decoy );
+		check( paths_of( buf, pmm_lookupper::find_path_spans( buf, '\0' ) ) == expected, name + ": wrong paths from the scan" );
+	}
+
+	// Files the layout does not fit are scanned whole.
+	void fallback()
+	{
+		auto const buf = read_fixture( 2 );
+		auto const scanned = paths_of( buf, pmm_lookupper::find_path_spans( buf, '\0' ) );
+
+		auto unknown = buf;
+		unknown[23] = '3';
+		check( !pmm_lookupper::parse_pmm_path_spans( unknown ), "unknown version read as a layout" );
+		check( paths_of( unknown, pmm_lookupper::pmm_path_spans( unknown ) ) == scanned, "unknown version not scanned" );
+
+		// Cut inside the second model.
+		auto const truncated = buf.substr( 0, buf.find( scene_paths[1] ) + 300 );
+		check( !pmm_lookupper::parse_pmm_path_spans( truncated ), "truncated file read as a layout" );
+		check(
+			paths_of( truncated, pmm_lookupper::pmm_path_spans( truncated ) ) == std::vector< std::string >( scanned.begin(), scanned.begin() + 3 ),
+			"truncated file not scanned"
+		);
+	}
+
+	std::vector< std::string > strings_of(boost::optional< pmm_lookupper::path_list > const& paths)
+	{
+		std::vector< std::string > result;
+		for( std::size_t i = 0; paths && i < paths->size(); ++i ) {
+			result.push_back( ( *paths )[i].to_string() );
+		}
+
+		return result;
+	}
+
+	// Scenes of pmm_stream_size or more are streamed instead of mapped; either
+	// way the layout is read, decoy or not, and a file it does not fit is scanned.
+	void stream_matches_buffer(std::string const& dir)
+	{
+		auto const v2 = read_fixture( 2 );
+		auto unknown = v2;
+		unknown[23] = '3';
+		std::string const scenes[] = {
+			read_fixture( 1 ), v2, unknown, v2.substr( 0, v2.find( scene_paths[1] ) + 300 ), v2.substr( 0, 29 )
+		};
+
+		for( std::size_t i = 0; i < sizeof( scenes ) / sizeof( scenes[0] ); ++i ) {
+			auto const file = pmm_lookupper::join_path( dir, "stream_" + std::to_string( i ) + ".pmm" );
+			{
+				std::ofstream ofs( file, std::ios::binary );
+				ofs << scenes[i];
+			}
+
+			auto const expected = strings_of( pmm_lookupper::parse_pmm_buffer( scenes[i] ) );
+			check( i > 1 || expected == scene_paths, "decoy read from scene " + std::to_string( i ) );
+			for( std::size_t window : { 7, 300, 64 * 1024 } ) {
+				check(
+					strings_of( pmm_lookupper::parse_pmm_stream( file, window ) ) == expected,
+					"streamed scene " + std::to_string( i ) + " differs, window " + std::to_string( window )
+				);
+			}
+
+			pmm_lookupper::remove_file( file );
+		}
+	}
+
+	// The generator writes the fixtures byte for byte but for the decoy, so the
+	// corpus of the benchmarks follows the same layout.
+	void generator_matches(int version)
+	{
+		auto const buf = read_fixture( version );
+		auto const made = pmm_lookupper::bench::make_pmm( { version, 2, 3, 2, 2, 1 }, 3 );
+
+		auto const at = decoy_offset[version];
+		bool same = buf.size() == made.size();
+		for( std::size_t i = 0; same && i < buf.size(); ++i ) {
+			same = ( i >= at && i < at + decoy.size() + 2 ) || buf[i] == made[i];
+		}
+		check( same, "make_pmm differs from scene_v" + std::to_string( version ) );
+	}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+	for( int version = 1; version <= 2; ++version ) {
+		layout( version );
+		generator_matches( version );
+	}
+	fallback();
+	stream_matches_buffer( argc > 1 ? argv[1] : "." );
+
+	return pmm_lookupper::test::finish( "pmm" );
+}
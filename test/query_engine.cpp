@@ -0,0 +1,170 @@
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "../src/options.hpp"
+#include "../src/query_engine.hpp"
+#include "../bench/corpus.hpp"
+#include "check.hpp"
+
+namespace {
+
+	using pmm_lookupper::test::check;
+
+	struct published
+	{
+		std::shared_ptr< pmm_lookupper::string_pool const > strings;
+		std::size_t size;
+	};
+
+	// A pool handed to the listener is read by the UI thread from then on, so it
+	// must not change while queries keep running, folder-only ones included.
+	void published_pools_stay_unchanged(std::vector< std::string > const& files)
+	{
+		std::mutex mtx;
+		std::vector< published > pools;
+		std::atomic< bool > done( false );
+		std::atomic< std::size_t > results( 0 );
+
+		pmm_lookupper::query_listener listener;
+		listener.result = [&](pmm_lookupper::query_result r) {
+			std::lock_guard< std::mutex > lock( mtx );
+			pools.push_back( { r.strings, r.strings->size() } );
+			for( auto const id : r.rows ) {
+				check( id < r.strings->size(), "a row outside its pool" );
+			}
+			++results;
+		};
+
+		std::thread reader( [&] {
+			for(;;) {
+				bool const last = done;
+				std::vector< published > snapshot;
+				{
+					std::lock_guard< std::mutex > lock( mtx );
+					snapshot = pools;
+				}
+
+				std::size_t chars = 0;
+				for( auto const& p : snapshot ) {
+					for( std::size_t i = 0; i < p.size; ++i ) {
+						chars += ( *p.strings )[static_cast< pmm_lookupper::string_id >( i )].size();
+					}
+					check( p.strings->size() == p.size, "a published pool grew" );
+				}
+				check( snapshot.empty() || chars > 0, "published pools are empty" );
+				if( last ) {
+					break;
+				}
+			}
+		} );
+
+		pmm_lookupper::thread_pool pool;
+		{
+			pmm_lookupper::query_engine engine( pool, listener );
+
+			pmm_lookupper::query_options opts;
+			opts.extensions = pmm_lookupper::parse_extensions( pmm_lookupper::default_extensions );
+			opts.order = pmm_lookupper::sort_order::path;
+			opts.duplication = false;
+
+			// A file result first, so that its pool is out before any folder query.
+			opts.folder_only = false;
+			engine.load( files );
+			engine.query( opts );
+			engine.wait();
+			for( int i = 0; i < 200; ++i ) {
+				opts.folder_only = i % 3 != 1;
+				opts.duplication = i % 2 == 0;
+				engine.query( opts );
+				if( i % 10 == 0 ) {
+					engine.wait();
+				}
+			}
+			engine.wait();
+		}
+
+		done = true;
+		reader.join();
+		check( results > 0, "no results" );
+		for( auto const& p : pools ) {
+			check( p.strings->size() == p.size, "a published pool grew" );
+		}
+	}
+
+	// The rows shown before the index is built are the ones the index then
+	// puts first.
+	void first_rows_are_a_prefix()
+	{
+		static char const* const exts[] = { "pmx", "pmd", "x", "wav", "fx", "PMX", "png" };
+		static pmm_lookupper::sort_order const orders[] = {
+			pmm_lookupper::sort_order::path, pmm_lookupper::sort_order::extension, pmm_lookupper::sort_order::input
+		};
+
+		std::mt19937 rng( 21 );
+		for( int round = 0; round < 30; ++round ) {
+			// Some paths again under a lower-case drive, naming the same file.
+			auto paths = pmm_lookupper::bench::make_paths( 10 + rng() % 5000, rng() );
+			for( std::size_t i = 0, n = paths.size(); i < n; i += 5 ) {
+				auto path = paths[i].to_string();
+				path[0] = static_cast< char >( path[0] - 'A' + 'a' );
+				paths.push_back( path );
+			}
+
+			pmm_lookupper::string_pool pool;
+			auto const data = pmm_lookupper::intern_paths( paths, pool );
+			pmm_lookupper::sort_keys const keys( pool );
+			pmm_lookupper::path_aliases const aliases( data, pool );
+
+			for( int q = 0; q < 10; ++q ) {
+				pmm_lookupper::query_options opts;
+				std::string selected;
+				for( auto const e : exts ) {
+					if( rng() % 2 == 0 ) {
+						selected += std::string( e ) + " ";
+					}
+				}
+				opts.extensions = pmm_lookupper::parse_extensions( selected );
+				opts.folder_only = false;
+				opts.duplication = rng() % 2 == 0;
+				opts.order = orders[rng() % 3];
+				std::size_t const n = rng() % 3 == 0 ? rng() % 10 : rng() % 2000;
+
+				auto expected = pmm_lookupper::run_query( data, pool, keys, aliases, opts );
+				expected.resize( std::min( n, expected.size() ) );
+				if( !check( pmm_lookupper::first_rows( data, pool, opts, n ) == expected, "first_rows is not a prefix, round " + std::to_string( round ) ) ) {
+					return;
+				}
+			}
+		}
+	}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+	namespace bench = pmm_lookupper::bench;
+
+	std::string const dir = argc > 1 ? argv[1] : ".";
+	std::vector< std::string > files;
+	for( std::uint32_t i = 0; i < 20; ++i ) {
+		auto const name = pmm_lookupper::join_path( dir, "engine_" + std::to_string( i ) + ".pmm" );
+		if( !check( bench::write_file( name, bench::make_pmm( { 2, 8, 16, 4, 0, 4 }, i ) ), "cannot write " + name ) ) {
+			return 1;
+		}
+		files.push_back( name );
+	}
+
+	first_rows_are_a_prefix();
+	published_pools_stay_unchanged( files );
+
+	for( auto const& f : files ) {
+		pmm_lookupper::remove_file( f );
+	}
+
+	return pmm_lookupper::test::finish( "query_engine" );
+}
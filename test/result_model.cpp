@@ -0,0 +1,116 @@
+#include <memory>
+#include <string>
+#include <vector>
+#include "../src/result_model.hpp"
+#include "check.hpp"
+
+namespace {
+
+	using pmm_lookupper::test::check;
+
+	std::shared_ptr< pmm_lookupper::string_pool > make_rows(std::vector< std::string > const& paths, pmm_lookupper::id_list& ids)
+	{
+		auto pool = std::make_shared< pmm_lookupper::string_pool >();
+		for( auto const& p : paths ) {
+			ids.push_back( pool->intern( p ) );
+		}
+
+		return pool;
+	}
+
+	std::vector< std::string > numbered(std::size_t n, std::string const& dir)
+	{
+		std::vector< std::string > result;
+		for( std::size_t i = 0; i < n; ++i ) {
+			result.push_back( dir + std::to_string( i ) + ".pmx" );
+		}
+
+		return result;
+	}
+
+	std::wstring wide_numbered(std::size_t i, std::wstring const& dir)
+	{
+		auto const n = std::to_string( i );
+		return dir + std::wstring( n.begin(), n.end() ) + L".pmx";
+	}
+
+	// Rows are right at both edges of a window and on either side of it, and a
+	// row inside the window keeps its text while other rows of it are read.
+	void windows()
+	{
+		pmm_lookupper::id_list ids;
+		auto const pool = make_rows( numbered( 10, "C:\\\xe8\xa1\xa8\xe7\xa4\xba\\" ), ids );
+		std::wstring const dir = L"C:\\\x8868\x793a\\";
+
+		pmm_lookupper::result_model model( 4 );
+		model.reset( pool, ids );
+
+		model.prepare( 2, 5 );
+		auto const first = model.wide( 2 );
+		check( model.wide( 5 ) == wide_numbered( 5, dir ), "last row of the window" );
+		check( first == wide_numbered( 2, dir ), "window converted again inside itself" );
+
+		for( std::size_t row : { 6, 1, 9, 0, 5, 2 } ) {
+			check( model.wide( row ) == wide_numbered( row, dir ), "row " + std::to_string( row ) + " around the window" );
+		}
+
+		// Clamped to the rows there are; out-of-order and empty ranges do nothing.
+		model.prepare( 8, 100 );
+		check( model.wide( 9 ) == wide_numbered( 9, dir ), "clamped window" );
+		model.prepare( 5, 4 );
+		check( model.wide( 8 ) == wide_numbered( 8, dir ), "empty range moved the window" );
+
+		pmm_lookupper::result_model empty;
+		empty.prepare( 0, 10 );
+		check( empty.size() == 0, "empty model" );
+	}
+
+	// A reset result is never served from the rows converted before it.
+	void reset_drops_window()
+	{
+		pmm_lookupper::id_list before, after;
+		auto const old_pool = make_rows( numbered( 8, "C:\\old\\" ), before );
+		auto const new_pool = make_rows( numbered( 8, "D:\\new\\" ), after );
+
+		pmm_lookupper::result_model model( 16 );
+		model.reset( old_pool, before );
+		model.prepare( 0, 7 );
+		check( model.wide( 3 ) == wide_numbered( 3, L"C:\\old\\" ), "old row" );
+
+		model.reset( new_pool, after );
+		for( std::size_t row = 0; row < 8; ++row ) {
+			check( model.wide( row ) == wide_numbered( row, L"D:\\new\\" ), "stale row " + std::to_string( row ) );
+		}
+
+		model.reset( old_pool, { before[5] } );
+		check( model.size() == 1 && model.wide( 0 ) == wide_numbered( 5, L"C:\\old\\" ), "stale row after shrinking" );
+	}
+
+	void type_ahead()
+	{
+		pmm_lookupper::id_list ids;
+		auto const pool = make_rows( { "C:\\b.pmx", "D:\\a.pmx", "c:\\a.pmx", "C:\\A.PMX", "e:\\x" }, ids );
+
+		pmm_lookupper::result_model model;
+		model.reset( pool, ids );
+
+		check( model.find( "c:\\a", 0, true, false ) == 2, "prefix" );
+		check( model.find( "C:\\A", 3, true, false ) == 3, "prefix from start" );
+		check( model.find( "c:\\b", 1, true, false ) == 5, "match before start without wrap" );
+		check( model.find( "c:\\b", 1, true, true ) == 0, "match before start with wrap" );
+		check( model.find( "c:\\a", 0, false, false ) == 5, "prefix taken as a whole path" );
+		check( model.find( "C:\\a.pmx", 0, false, false ) == 2, "whole path" );
+		check( model.find( "E:\\X", 100, true, true ) == 4, "start past the end" );
+		check( model.find( "f", 0, true, true ) == 5, "no match" );
+	}
+
+} // namespace
+
+int main()
+{
+	windows();
+	reset_drops_window();
+	type_ahead();
+
+	return pmm_lookupper::test::finish( "result_model" );
+}
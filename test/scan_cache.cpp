@@ -0,0 +1,214 @@
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <boost/optional.hpp>
+#include "../src/scan_cache.hpp"
+#include "check.hpp"
+
+namespace {
+
+	using pmm_lookupper::test::check;
+
+	bool write(std::string const& file, std::string const& data)
+	{
+		std::ofstream ofs( file, std::ios::binary | std::ios::trunc );
+		ofs << data;
+
+		return !ofs.fail();
+	}
+
+	// Parses a file as one path, its whole contents, counting the calls.
+	struct whole_file
+	{
+		int* calls;
+
+		boost::optional< pmm_lookupper::path_list > operator()(boost::string_ref buf) const
+		{
+			++*calls;
+			pmm_lookupper::path_list result;
+			result.push_back( buf );
+
+			return result;
+		}
+	};
+
+	bool holds(boost::optional< pmm_lookupper::path_list > const& result, std::string const& path)
+	{
+		return result && result->size() == 1 && ( *result )[0] == path;
+	}
+
+	// A saved entry is answered by the next cache without parsing.
+	void round_trip(std::string const& dir)
+	{
+		auto const cache_file = pmm_lookupper::join_path( dir, "round_trip.bin" );
+		auto const file = pmm_lookupper::join_path( dir, "round_trip.pmm" );
+		pmm_lookupper::remove_file( cache_file );
+		if( !check( write( file, "C:\\a.pmx" ), "cannot write " + file ) ) {
+			return;
+		}
+
+		int calls = 0;
+		{
+			pmm_lookupper::scan_cache cache( cache_file );
+			check( holds( cache.scan( file, whole_file{ &calls } ), "C:\\a.pmx" ), "first scan" );
+			check( cache.save(), "cannot save" );
+		}
+
+		pmm_lookupper::scan_cache cache( cache_file );
+		check( cache.size() == 1, "entry not loaded" );
+		check( holds( cache.scan( file, whole_file{ &calls } ), "C:\\a.pmx" ), "cached scan" );
+		check( calls == 1, "unchanged file parsed again" );
+
+		pmm_lookupper::remove_file( file );
+	}
+
+	// An entry only answers for the size and modification time it was stored with.
+	void changed_file_is_stale(std::string const& dir)
+	{
+		auto const cache_file = pmm_lookupper::join_path( dir, "stale.bin" );
+		auto const file = pmm_lookupper::join_path( dir, "stale.pmm" );
+		pmm_lookupper::remove_file( cache_file );
+		if( !check( write( file, "C:\\a.pmx" ), "cannot write " + file ) ) {
+			return;
+		}
+
+		int calls = 0;
+		pmm_lookupper::scan_cache cache( cache_file );
+		cache.scan( file, whole_file{ &calls } );
+
+		auto st = pmm_lookupper::get_file_status( file );
+		boost::optional< pmm_lookupper::path_list > result;
+		check( cache.find( file, st, result ), "entry not found" );
+		++st.mtime;
+		check( !cache.find( file, st, result ), "entry found for another mtime" );
+		--st.mtime;
+		++st.size;
+		check( !cache.find( file, st, result ), "entry found for another size" );
+
+		write( file, "C:\\longer.pmx" );
+		check( holds( cache.scan( file, whole_file{ &calls } ), "C:\\longer.pmx" ), "stale entry served" );
+		check( calls == 2, "changed file not parsed" );
+
+		pmm_lookupper::remove_file( file );
+	}
+
+	// A file gone since it was cached loses its entry, on disk too.
+	void missing_file_forgotten(std::string const& dir)
+	{
+		auto const cache_file = pmm_lookupper::join_path( dir, "forget.bin" );
+		auto const file = pmm_lookupper::join_path( dir, "forget.pmm" );
+		pmm_lookupper::remove_file( cache_file );
+		if( !check( write( file, "C:\\a.pmx" ), "cannot write " + file ) ) {
+			return;
+		}
+
+		int calls = 0;
+		{
+			pmm_lookupper::scan_cache cache( cache_file );
+			cache.scan( file, whole_file{ &calls } );
+			cache.save();
+		}
+
+		pmm_lookupper::remove_file( file );
+		{
+			pmm_lookupper::scan_cache cache( cache_file );
+			check( !cache.scan( file, whole_file{ &calls } ), "missing file scanned" );
+			check( cache.size() == 0, "missing file kept" );
+			cache.forget( file );
+			check( cache.save(), "cannot save" );
+		}
+
+		pmm_lookupper::scan_cache cache( cache_file );
+		check( cache.size() == 0, "missing file saved" );
+	}
+
+	// Two caches on one file saving at once both end up in it.
+	void concurrent_saves_merge(std::string const& dir)
+	{
+		auto const cache_file = pmm_lookupper::join_path( dir, "concurrent.bin" );
+		std::vector< std::string > files;
+		for( int i = 0; i < 16; ++i ) {
+			files.push_back( pmm_lookupper::join_path( dir, "concurrent_" + std::to_string( i ) + ".pmm" ) );
+			if( !check( write( files.back(), "C:\\" + std::to_string( i ) + ".pmx" ), "cannot write " + files.back() ) ) {
+				return;
+			}
+		}
+
+		for( int round = 0; round < 20; ++round ) {
+			pmm_lookupper::remove_file( cache_file );
+
+			int calls = 0;
+			pmm_lookupper::scan_cache a( cache_file );
+			pmm_lookupper::scan_cache b( cache_file );
+			for( std::size_t i = 0; i < files.size(); ++i ) {
+				( i % 2 == 0 ? a : b ).scan( files[i], whole_file{ &calls } );
+			}
+
+			bool saved_a = false;
+			bool saved_b = false;
+			std::thread ta( [&] { saved_a = a.save(); } );
+			std::thread tb( [&] { saved_b = b.save(); } );
+			ta.join();
+			tb.join();
+			check( saved_a && saved_b, "cannot save" );
+
+			pmm_lookupper::scan_cache merged( cache_file );
+			if( !check( merged.size() == files.size(), "entries lost, round " + std::to_string( round ) ) ) {
+				break;
+			}
+		}
+
+		for( auto const& f : files ) {
+			pmm_lookupper::remove_file( f );
+		}
+	}
+
+	// A cache written with another version is dropped whole.
+	void other_version_dropped(std::string const& dir)
+	{
+		auto const cache_file = pmm_lookupper::join_path( dir, "version.bin" );
+		auto const file = pmm_lookupper::join_path( dir, "version.pmm" );
+		pmm_lookupper::remove_file( cache_file );
+		if( !check( write( file, "C:\\a.pmx" ), "cannot write " + file ) ) {
+			return;
+		}
+
+		int calls = 0;
+		{
+			pmm_lookupper::scan_cache cache( cache_file );
+			cache.scan( file, whole_file{ &calls } );
+			cache.save();
+		}
+
+		std::string bytes;
+		{
+			std::ifstream ifs( cache_file, std::ios::binary );
+			bytes.assign( std::istreambuf_iterator< char >( ifs ), std::istreambuf_iterator< char >() );
+		}
+		if( !check( bytes.size() > 8, "cache not written" ) ) {
+			return;
+		}
+		bytes[6] = static_cast< char >( pmm_lookupper::scan_cache::version - 1 );
+		write( cache_file, bytes );
+
+		pmm_lookupper::scan_cache cache( cache_file );
+		check( cache.size() == 0, "cache of another version loaded" );
+
+		pmm_lookupper::remove_file( file );
+	}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+	std::string const dir = argc > 1 ? argv[1] : ".";
+
+	round_trip( dir );
+	changed_file_is_stale( dir );
+	missing_file_forgotten( dir );
+	concurrent_saves_merge( dir );
+	other_version_dropped( dir );
+
+	return pmm_lookupper::test::finish( "scan_cache" );
+}
@@ -0,0 +1,105 @@
+#include <cstdint>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "../src/pmm.hpp"
+#include "../bench/corpus.hpp"
+#include "check.hpp"
+
+namespace {
+
+	using pmm_lookupper::test::check;
+
+	std::vector< std::string > buffered(std::string const& buf)
+	{
+		std::vector< std::string > result;
+		pmm_lookupper::for_each_file_path( boost::string_ref( buf ), '\0', [&](boost::string_ref p) {
+			result.push_back( p.to_string() );
+		} );
+
+		return result;
+	}
+
+	std::vector< std::string > streamed(std::string const& buf, std::size_t window)
+	{
+		std::vector< std::string > result;
+		std::istringstream is( buf );
+		pmm_lookupper::for_each_file_path( is, '\0', [&](boost::string_ref p) {
+			result.push_back( p.to_string() );
+		}, window );
+
+		return result;
+	}
+
+	// Paths, Shift-JIS double bytes and stray drive letters at random, cut at
+	// every kind of window boundary.
+	void stream_matches_buffer()
+	{
+		static char const* const pieces[] = {
+			"C:\\MMD\\a.pmx", "\0", "\x82\xa0", "\x83\x5c", "x:", ":\\", "D:\\\x95\x5c\\b.x", "\0\0", "Z", "\\"
+		};
+
+		std::mt19937 rng( 11 );
+		std::uniform_int_distribution< std::size_t > piece( 0, sizeof( pieces ) / sizeof( pieces[0] ) - 1 );
+		for( int round = 0; round < 300; ++round ) {
+			std::string buf;
+			auto const n = rng() % 200;
+			for( std::size_t i = 0; i < n; ++i ) {
+				auto const p = pieces[piece( rng )];
+				buf.append( p, p[0] ? std::char_traits< char >::length( p ) : 1 );
+			}
+
+			auto const expected = buffered( buf );
+			for( std::size_t window : { 1, 2, 3, 7, 64 } ) {
+				check( streamed( buf, window ) == expected, "stream and buffer differ, window " + std::to_string( window ) );
+			}
+		}
+	}
+
+	// A path longer than any Windows path is dropped, and scanning goes on after
+	// its end.
+	void overlong_path_dropped()
+	{
+		std::string const tail( "\0E:\\next.wav\0", 13 );
+		std::string const unterminated = "C:\\" + std::string( 200 * 1024, 'a' );
+
+		check( streamed( unterminated + tail, 4096 ) == std::vector< std::string >{ "E:\\next.wav" }, "overlong path kept" );
+		check( streamed( unterminated, 4096 ).empty(), "unterminated overlong path kept" );
+		check( streamed( "C:\\short" + tail, 4 ) == std::vector< std::string >( { "C:\\short", "E:\\next.wav" } ), "short path lost" );
+	}
+
+	// The streamed parse finds what the parse of the mapped file finds.
+	void pmm_stream_matches_scan(std::string const& dir)
+	{
+		namespace bench = pmm_lookupper::bench;
+
+		auto const file = pmm_lookupper::join_path( dir, "stream.pmm" );
+		auto const data = bench::make_pmm( { 2, 8, 16, 4, 0, 4 }, 5 );
+		if( !check( bench::write_file( file, data ), "cannot write " + file ) ) {
+			return;
+		}
+
+		auto const paths = pmm_lookupper::parse_pmm_stream( file, 1000 );
+		auto const expected = pmm_lookupper::parse_pmm_buffer( boost::string_ref( data.data(), data.size() ) );
+		if( check( !!paths && !!expected, "stream.pmm is not a .pmm" ) ) {
+			bool same = paths->size() == expected->size();
+			for( std::size_t i = 0; same && i < paths->size(); ++i ) {
+				same = ( *paths )[i] == ( *expected )[i];
+			}
+			check( same, "streamed .pmm differs from the mapped one" );
+		}
+
+		pmm_lookupper::remove_file( file );
+	}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+	stream_matches_buffer();
+	overlong_path_dropped();
+	pmm_stream_matches_scan( argc > 1 ? argv[1] : "." );
+
+	return pmm_lookupper::test::finish( "scanner" );
+}
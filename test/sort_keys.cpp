@@ -0,0 +1,91 @@
+#include <algorithm>
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+#include <boost/range/algorithm.hpp>
+#include "../src/query.hpp"
+#include "../src/sort_keys.hpp"
+#include "../bench/corpus.hpp"
+#include "check.hpp"
+
+namespace {
+
+	using pmm_lookupper::test::check;
+
+	// Against stable_sort on keys of every width, below and above the size at
+	// which radix_sort stops comparing.
+	void radix_matches_stable_sort()
+	{
+		std::mt19937_64 rng( 16 );
+		for( int round = 0; round < 40; ++round ) {
+			std::size_t const n = round % 2 ? 1024 + rng() % 20000 : rng() % 1024;
+			auto const bits = 1 + rng() % 64;
+			std::uint64_t const mask = bits == 64 ? ~std::uint64_t( 0 ) : ( std::uint64_t( 1 ) << bits ) - 1;
+			// Keys sharing their upper digits, so that whole digits are skipped.
+			auto const high = rng() & ~mask;
+
+			std::vector< std::uint64_t > keys( n );
+			for( auto& k : keys ) {
+				k = high | ( rng() & mask );
+			}
+			pmm_lookupper::id_list ids( n );
+			for( std::size_t i = 0; i < n; ++i ) {
+				ids[i] = static_cast< pmm_lookupper::string_id >( rng() % n );
+			}
+
+			auto expected = ids;
+			std::stable_sort( expected.begin(), expected.end(), [&keys](pmm_lookupper::string_id lhs, pmm_lookupper::string_id rhs) {
+				return keys[lhs] < keys[rhs];
+			} );
+			pmm_lookupper::radix_sort( ids, [&keys](pmm_lookupper::string_id id) {
+				return keys[id];
+			} );
+			check( ids == expected, "radix_sort differs, " + std::to_string( n ) + " keys of " + std::to_string( bits ) + " bits" );
+		}
+	}
+
+	// The two orders against the string sorts that they replaced, with repeated
+	// ids and extensions that are not ASCII.
+	void keys_match_string_sorts()
+	{
+		std::mt19937 rng( 61 );
+		for( int round = 0; round < 20; ++round ) {
+			auto paths = pmm_lookupper::bench::make_paths( 100 + rng() % 20000, rng() );
+			for( int i = 0; i < 50; ++i ) {
+				paths.push_back( "C:\\MMD\\\x95\x5c\\a_" + std::to_string( rng() % 30 ) + ".\x95\x5c" );
+				paths.push_back( "C:\\MMD\\noext_" + std::to_string( rng() % 30 ) );
+			}
+
+			pmm_lookupper::string_pool pool;
+			auto const data = pmm_lookupper::intern_paths( paths, pool );
+			pmm_lookupper::sort_keys const keys( pool );
+
+			auto by_path = data;
+			boost::sort( by_path, [&pool](pmm_lookupper::string_id lhs, pmm_lookupper::string_id rhs) {
+				return pool[lhs] < pool[rhs];
+			} );
+			auto by_ext = by_path;
+			boost::stable_sort( by_ext, [&pool](pmm_lookupper::string_id lhs, pmm_lookupper::string_id rhs) {
+				return boost::lexicographical_compare( pmm_lookupper::extension_of( pool[lhs] ), pmm_lookupper::extension_of( pool[rhs] ) );
+			} );
+
+			auto ids = data;
+			keys.sort_by_path( ids );
+			check( ids == by_path, "sort_by_path differs, round " + std::to_string( round ) );
+
+			ids = data;
+			keys.sort_by_extension( ids );
+			check( ids == by_ext, "sort_by_extension differs, round " + std::to_string( round ) );
+		}
+	}
+
+} // namespace
+
+int main()
+{
+	radix_matches_stable_sort();
+	keys_match_string_sorts();
+
+	return pmm_lookupper::test::finish( "sort_keys" );
+}
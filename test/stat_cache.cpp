@@ -0,0 +1,191 @@
+#include <chrono>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include "../src/filter_engine.hpp"
+#include "../src/stat_cache.hpp"
+#include "check.hpp"
+
+#ifdef _WIN32
+#	include <direct.h>
+#else
+#	include <sys/stat.h>
+#	include <unistd.h>
+#endif
+
+namespace {
+
+	using pmm_lookupper::test::check;
+
+	using duration = pmm_lookupper::stat_cache::clock::duration;
+
+	auto const max_age = std::chrono::milliseconds( 500 );
+
+	duration age(bool expires)
+	{
+		return expires ? std::chrono::duration_cast< duration >( max_age ) : duration::zero();
+	}
+
+	void expire()
+	{
+		std::this_thread::sleep_for( max_age + std::chrono::milliseconds( 200 ) );
+	}
+
+	void create(std::string const& file)
+	{
+		std::ofstream ofs( file, std::ios::binary );
+		ofs << "x";
+	}
+
+	bool make_directory(std::string const& dir)
+	{
+#ifdef _WIN32
+		return ::_mkdir( dir.c_str() ) == 0;
+#else
+		return ::mkdir( dir.c_str(), 0755 ) == 0;
+#endif
+	}
+
+	void remove_directory(std::string const& dir)
+	{
+#ifdef _WIN32
+		::_rmdir( dir.c_str() );
+#else
+		::rmdir( dir.c_str() );
+#endif
+	}
+
+	// A removed file is still there until its entry expires, and forever when
+	// max_age is zero.
+	void get_expires(std::string const& dir)
+	{
+		auto const file = pmm_lookupper::join_path( dir, "stat_get.pmx" );
+		pmm_lookupper::thread_pool pool( 2 );
+
+		for( bool const expires : { true, false } ) {
+			pmm_lookupper::stat_cache stats( pool, age( expires ) );
+			auto const what = expires ? " with max_age" : " without max_age";
+
+			create( file );
+			check( stats.get( file ).exists, "file not found" + std::string( what ) );
+			pmm_lookupper::remove_file( file );
+			check( stats.get( file ).exists, "cached status not used" + std::string( what ) );
+
+			expire();
+			check( stats.get( file ).exists != expires, expires ? "status not refreshed after max_age" : "status expired without max_age" );
+		}
+	}
+
+	// A batch is stat'ed once, duplicates included, and again once it expires;
+	// a cancelled batch stores nothing.
+	void prefetch_expires(std::string const& dir)
+	{
+		std::vector< std::string > files;
+		for( int i = 0; i < 64; ++i ) {
+			files.push_back( pmm_lookupper::join_path( dir, "stat_batch_" + std::to_string( i ) + ".pmx" ) );
+			if( i % 2 == 0 ) {
+				create( files.back() );
+			}
+		}
+		auto paths = files;
+		paths.insert( paths.end(), files.begin(), files.begin() + 10 );
+
+		auto const flip = [&] {
+			for( std::size_t i = 0; i < files.size(); ++i ) {
+				if( pmm_lookupper::get_file_status( files[i] ).exists ) {
+					pmm_lookupper::remove_file( files[i] );
+				}
+				else {
+					create( files[i] );
+				}
+			}
+		};
+		auto const all_cached = [&](pmm_lookupper::stat_cache& stats, bool even_exist) {
+			for( std::size_t i = 0; i < files.size(); ++i ) {
+				if( stats.get( files[i] ).exists != ( ( i % 2 == 0 ) == even_exist ) ) {
+					return false;
+				}
+			}
+			return true;
+		};
+
+		pmm_lookupper::thread_pool pool( 4 );
+		pmm_lookupper::stat_cache stats( pool, age( true ) );
+
+		pmm_lookupper::cancel_token cancel;
+		cancel.cancel();
+		stats.prefetch( paths, &cancel );
+		flip();
+		check( all_cached( stats, false ), "a cancelled prefetch stored statuses" );
+		flip();
+
+		expire();
+		stats.prefetch( paths );
+		flip();
+		check( all_cached( stats, true ), "prefetched statuses not used" );
+
+		expire();
+		stats.prefetch( paths );
+		check( all_cached( stats, false ), "prefetch kept expired statuses" );
+
+		for( auto const& f : files ) {
+			pmm_lookupper::remove_file( f );
+		}
+	}
+
+	// Folder lists follow the expiry of the stat cache: a path that becomes a
+	// directory is its own folder once its status expires, and never without
+	// max_age.
+	void folders_expire(std::string const& dir)
+	{
+		auto const parent = pmm_lookupper::join_path( dir, "stat_folder" );
+		// The parent as intern_folders finds it, by the last '\'.
+		auto const path = parent + "\\thing.pmx";
+		remove_directory( path );
+		make_directory( parent );
+
+		pmm_lookupper::thread_pool pool( 2 );
+		for( bool const expires : { true, false } ) {
+			pmm_lookupper::stat_cache stats( pool, age( expires ) );
+
+			auto strings = std::make_shared< pmm_lookupper::string_pool >();
+			pmm_lookupper::id_list const ids = { strings->intern( path ) };
+			pmm_lookupper::filter_engine engine( strings, ids, &stats );
+
+			pmm_lookupper::query_options opts;
+			opts.folder_only = true;
+			opts.duplication = false;
+			opts.order = pmm_lookupper::sort_order::path;
+			auto const folder_of = [&] {
+				auto const& rows = engine.query( opts );
+				return rows.size() == 1 ? ( *strings )[rows[0]].to_string() : std::string();
+			};
+
+			check( folder_of() == parent, "folder of a file" );
+			if( !check( make_directory( path ), "cannot create " + path ) ) {
+				return;
+			}
+			check( folder_of() == parent, "folder list not cached" );
+
+			expire();
+			check( folder_of() == ( expires ? path : parent ), expires ? "folder list not refreshed after max_age" : "folder list expired without max_age" );
+			remove_directory( path );
+		}
+
+		remove_directory( parent );
+	}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+	std::string const dir = argc > 1 ? argv[1] : ".";
+
+	get_expires( dir );
+	prefetch_expires( dir );
+	folders_expire( dir );
+
+	return pmm_lookupper::test::finish( "stat_cache" );
+}
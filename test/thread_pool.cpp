@@ -0,0 +1,51 @@
+#include <atomic>
+#include <cstddef>
+#include "../src/thread_pool.hpp"
+#include "check.hpp"
+
+namespace {
+
+	using pmm_lookupper::test::check;
+
+	// Tasks posted while the workers are still starting, from outside and from
+	// tasks, all run once.
+	void tasks_posted_at_start_run_once()
+	{
+		for( std::size_t n = 1; n <= 8; ++n ) {
+			std::atomic< std::size_t > done( 0 );
+			{
+				pmm_lookupper::thread_pool pool( n );
+				pmm_lookupper::task_group group( pool );
+				for( int i = 0; i < 64; ++i ) {
+					group.run( [&] {
+						group.run( [&] { ++done; } );
+						++done;
+					} );
+				}
+				group.wait();
+			}
+			check( done == 128, "a task ran a wrong number of times" );
+		}
+	}
+
+	void parallel_for_covers_range()
+	{
+		pmm_lookupper::thread_pool pool( 4 );
+		for( std::size_t n : { 0, 1, 5, 1000 } ) {
+			std::atomic< std::size_t > sum( 0 );
+			pmm_lookupper::parallel_for( pool, n, [&](std::size_t i) { sum += i + 1; } );
+			check( sum == n * ( n + 1 ) / 2, "parallel_for missed an index" );
+		}
+	}
+
+} // namespace
+
+int main()
+{
+	for( int i = 0; i < 50; ++i ) {
+		tasks_posted_at_start_run_once();
+	}
+	parallel_for_covers_range();
+
+	return pmm_lookupper::test::finish( "thread_pool" );
+}
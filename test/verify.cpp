@@ -0,0 +1,124 @@
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "../src/verify.hpp"
+#include "../bench/corpus.hpp"
+#include "check.hpp"
+
+namespace {
+
+	using pmm_lookupper::test::check;
+
+	struct expected_asset
+	{
+		std::string path;
+		bool present;
+		std::uint64_t size;
+	};
+
+	// The paths of the scenes in test/data and of offscreen.emm, moved into dir as
+	// verify_a.pmx, verify_b.pmx, ... in the order they are first found. The
+	// second scene names the same files as the first, spelled through "." so the
+	// paths differ. verify_b.pmx, the second model of both scenes, is missing.
+	void missing_asset(std::string const& dir)
+	{
+		char const* const inputs[] = { "test/data/scene_v1.pmm", "test/data/scene_v2.pmm", "test/data/offscreen.emm", "test/data/none.pmm" };
+
+		std::vector< std::string > originals;
+		std::vector< pmm_lookupper::project > projects;
+		for( auto const input : inputs ) {
+			auto const loaded = pmm_lookupper::load_file( input );
+			auto const base = projects.size() == 1 ? pmm_lookupper::join_path( dir, "." ) : dir;
+
+			pmm_lookupper::project p;
+			p.file = input;
+			p.result.error = loaded.error;
+			for( std::size_t i = 0; i < loaded.paths.size(); ++i ) {
+				auto const path = loaded.paths[i].to_string();
+				auto const k = static_cast< std::size_t >( std::find( originals.begin(), originals.end(), path ) - originals.begin() );
+				if( k == originals.size() ) {
+					originals.push_back( path );
+				}
+				auto const name = "verify_" + std::string( 1, static_cast< char >( 'a' + k ) ) + pmm_lookupper::extension_of( path ).to_string();
+				p.result.paths.push_back( pmm_lookupper::join_path( base, name ) );
+			}
+			projects.push_back( std::move( p ) );
+		}
+		if( !check( originals.size() == 7 && !projects[2].result.error && projects[3].result.error, "fixtures changed" ) ) {
+			return;
+		}
+
+		auto const asset = [&](char c, char const* ext) {
+			return pmm_lookupper::join_path( dir, std::string( "verify_" ) + c + ext );
+		};
+		auto const shared = [&](char c, char const* ext) {
+			return pmm_lookupper::join_path( pmm_lookupper::join_path( dir, "." ), std::string( "verify_" ) + c + ext );
+		};
+		// Each file is as large as 10 times its place.
+		std::vector< std::string > const files = {
+			asset( 'a', ".pmx" ), asset( 'c', ".x" ), asset( 'd', ".wav" ), asset( 'e', ".fx" ), asset( 'f', ".fxsub" ), asset( 'g', ".fx" )
+		};
+		for( auto const& f : files ) {
+			auto const size = 10 * static_cast< std::size_t >( f[f.rfind( '_' ) + 1] - 'a' + 1 );
+			if( !check( pmm_lookupper::bench::write_file( f, std::vector< char >( size, 'x' ) ), "cannot write " + f ) ) {
+				return;
+			}
+		}
+		pmm_lookupper::remove_file( asset( 'b', ".pmx" ) );
+
+		std::vector< std::vector< expected_asset > > const expected = {
+			{ { asset( 'a', ".pmx" ), true, 10 }, { asset( 'b', ".pmx" ), false, 0 }, { asset( 'c', ".x" ), true, 30 } },
+			{ { shared( 'a', ".pmx" ), true, 10 }, { shared( 'b', ".pmx" ), false, 0 }, { shared( 'c', ".x" ), true, 30 } },
+			{ { asset( 'e', ".fx" ), true, 50 }, { asset( 'g', ".fx" ), true, 70 } },
+			{}
+		};
+
+		pmm_lookupper::string_pool strings;
+		pmm_lookupper::thread_pool pool( 4 );
+		pmm_lookupper::stat_cache stats( pool );
+		auto const report = pmm_lookupper::verify_assets( projects, { ".pmx", ".x", ".fx" }, strings, stats );
+
+		if( !check( report.projects.size() == projects.size(), "projects missing from the report" ) ) {
+			return;
+		}
+		for( std::size_t i = 0; i < projects.size(); ++i ) {
+			auto const& r = report.projects[i];
+			auto const what = " of " + r.file;
+
+			check( r.file == inputs[i] && r.error == projects[i].result.error, "wrong project" + what );
+			if( !check( r.assets.size() == expected[i].size(), "wrong number of assets" + what ) ) {
+				continue;
+			}
+			std::size_t missing = 0;
+			std::uint64_t bytes = 0;
+			for( std::size_t j = 0; j < r.assets.size(); ++j ) {
+				auto const& a = r.assets[j];
+				auto const& e = expected[i][j];
+				check( strings[a.path] == e.path, "asset " + std::to_string( j ) + what + " is " + strings[a.path].to_string() );
+				check( a.present == e.present && a.size == e.size, "wrong status of " + e.path );
+				missing += e.present ? 0 : 1;
+				bytes += e.size;
+			}
+			check( r.missing == missing && r.present_bytes == bytes, "wrong counts" + what );
+		}
+
+		// verify_b.pmx is missing from both scenes but counted once, as are the
+		// files they share.
+		check( report.assets == 5, "asset total " + std::to_string( report.assets ) );
+		check( report.missing == 1, "missing total " + std::to_string( report.missing ) );
+		check( report.present_bytes == 10 + 30 + 50 + 70, "present bytes total " + std::to_string( report.present_bytes ) );
+
+		for( auto const& f : files ) {
+			pmm_lookupper::remove_file( f );
+		}
+	}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+	missing_asset( argc > 1 ? argv[1] : "." );
+
+	return pmm_lookupper::test::finish( "verify" );
+}
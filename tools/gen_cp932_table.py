@@ -0,0 +1,42 @@
+#!/usr/bin/env python3
+# Generates src/cp932_table.hpp from Python's cp932 codec, which follows the
+# Windows code page 932 table (including the NEC and IBM extensions).
+#
+#     python3 tools/gen_cp932_table.py > src/cp932_table.hpp
+
+leads = [b for b in range(0x81, 0x100) if 0x81 <= b <= 0x9f or 0xe0 <= b <= 0xfc]
+trails = [b for b in range(0x40, 0xfd) if b != 0x7f]
+
+values = []
+for lead in leads:
+    for trail in trails:
+        try:
+            s = bytes([lead, trail]).decode('cp932')
+            values.append(ord(s) if len(s) == 1 else 0)
+        except UnicodeDecodeError:
+            values.append(0)
+
+print('''#ifndef PMM_LOOKUPPER_CP932_TABLE_HPP_
+#define PMM_LOOKUPPER_CP932_TABLE_HPP_
+
+// Generated by tools/gen_cp932_table.py. Do not edit.
+
+#include <cstddef>
+#include <cstdint>
+
+namespace pmm_lookupper { namespace cp932 {
+
+	std::size_t const lead_count = %d;
+	std::size_t const trail_count = %d;
+
+	// Indexed by lead_index( lead ) * trail_count + trail_index( trail ); 0 is unmapped.
+	constexpr std::uint16_t double_byte_table[lead_count * trail_count] = {''' % (len(leads), len(trails)))
+
+for i in range(0, len(values), 16):
+    print('\t\t' + ', '.join('0x%04x' % v for v in values[i:i + 16]) + ',')
+
+print('''	};
+
+} } // namespace pmm_lookupper::cp932
+
+#endif // PMM_LOOKUPPER_CP932_TABLE_HPP_''')